@@ -0,0 +1,344 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+/*
+ * Decoder benchmark. Every corpus is generated with a fixed seed, so runs are
+ * comparable, and the parse, decode and render stages are timed separately.
+ * Results go to stdout as JSON.
+ */
+#define BENCH_VALUES 200000
+#define BENCH_RUNS 3
+
+/* Fields the extract stage pulls out of every value, EC to WnR. */
+#define BENCH_FIELDS 6
+
+/* Longest line a generated value takes, "0x" plus 16 digits and a NUL. */
+#define BENCH_TOKEN_MAX 20
+
+#define EC(ec) ((u64)(ec) << 26)
+#define IL (1UL << 25)
+
+static u64 rng_state = 0x2545f4914f6cdd1dUL;
+
+/* xorshift64* */
+static u64 rnd(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545f4914f6cdd1dUL;
+}
+
+static u64 pick(const u64 *vals, size_t n)
+{
+	return vals[rnd() % n];
+}
+
+#define PICK(vals) pick(vals, sizeof(vals) / sizeof(vals[0]))
+
+/* Translation, access flag, permission, external abort and alignment. */
+static const u64 abort_fsc[] = {
+	0x04, 0x05, 0x06, 0x07, 0x09, 0x0a, 0x0b,
+	0x0d, 0x0e, 0x0f, 0x10, 0x21,
+};
+
+/* (op0 << 20) | (op2 << 17) | (op1 << 14) | (CRn << 10) | (CRm << 1) */
+#define SYSREG(op0, op1, crn, crm, op2)                                    \
+	(((u64)(op0) << 20) | ((u64)(op2) << 17) | ((u64)(op1) << 14) | \
+	 ((u64)(crn) << 10) | ((u64)(crm) << 1))
+
+/* Registers KVM commonly traps on: timers, GIC SGIs, PMU, ID and debug. */
+static const u64 trapped_sysregs[] = {
+	SYSREG(3, 3, 14, 2, 1),	 SYSREG(3, 3, 14, 2, 2),
+	SYSREG(3, 3, 14, 0, 1),	 SYSREG(3, 0, 12, 11, 5),
+	SYSREG(3, 0, 12, 12, 1), SYSREG(3, 3, 9, 12, 0),
+	SYSREG(3, 3, 9, 13, 0),	 SYSREG(3, 3, 14, 8, 0),
+	SYSREG(3, 0, 0, 4, 0),	 SYSREG(3, 0, 0, 6, 0),
+	SYSREG(3, 0, 1, 0, 0),	 SYSREG(3, 0, 10, 2, 0),
+	SYSREG(2, 0, 0, 2, 2),	 SYSREG(2, 0, 1, 0, 4),
+	SYSREG(3, 0, 5, 3, 1),	 SYSREG(3, 0, 2, 0, 0),
+};
+
+static u64 gen_data_abort(void)
+{
+	u64 esr = EC(0x24 + (rnd() & 1)) | IL | PICK(abort_fsc);
+
+	esr |= rnd() & (1UL << 6);
+	if (rnd() & 1) {
+		/* ISV, SAS, SSE, SRT, SF and AR */
+		esr |= (1UL << 24) | (rnd() & 0xffc000);
+	}
+	if ((esr & 0x3f) == 0x10) {
+		esr |= rnd() & (3UL << 11);
+	}
+	return esr;
+}
+
+static u64 gen_msr(void)
+{
+	return EC(0x18) | IL | PICK(trapped_sysregs) | (rnd() & (0x1fUL << 5)) |
+	       (rnd() & 1);
+}
+
+static u64 gen_serror(void)
+{
+	static const u64 aet[] = { 0, 1, 2, 3, 6 };
+
+	if (rnd() % 5 == 0) {
+		return EC(0x2f) | IL | (1UL << 24) | (rnd() & 0xffffff);
+	}
+	return EC(0x2f) | IL | 0x11 | (PICK(aet) << 10) | (rnd() & (1UL << 9));
+}
+
+static u64 gen_weighted(void)
+{
+	static const u64 insn_fsc[] = { 0x05, 0x06, 0x07, 0x0d, 0x0f };
+	unsigned int r = rnd() % 100;
+
+	if (r < 40) {
+		return gen_data_abort();
+	} else if (r < 65) {
+		return gen_msr();
+	} else if (r < 80) {
+		return gen_serror();
+	} else if (r < 88) {
+		return EC(0x20 + (rnd() & 1)) | IL | PICK(insn_fsc);
+	} else if (r < 94) {
+		return EC(0x15 + (rnd() & 1)) | IL;
+	} else if (r < 97) {
+		return EC(0x3c) | IL | ((rnd() & 1) ? 0x800 : 0x100);
+	} else {
+		return EC(0x01) | IL | (rnd() & 3);
+	}
+}
+
+static u64 gen_uniform(void)
+{
+	/* Everything above ISS2 is RES0. */
+	return rnd() & ((1UL << 37) - 1);
+}
+
+/*
+ * Values that decode into the most fields: the costliest ones for both the
+ * decoder and the printer. Picked by decoding random candidates, so the mix
+ * follows the decoders as they change.
+ */
+static u64 gen_worst(void)
+{
+	static u64 pool[256];
+	static size_t nr_pool;
+
+	if (!nr_pool) {
+		size_t best = 0;
+
+		while (nr_pool < 256) {
+			u64 esr = rnd() & 1 ? gen_weighted() : gen_uniform();
+			struct esr_result res;
+
+			esr_decode(esr, &res);
+			if (res.nr_fields > best) {
+				best = res.nr_fields;
+				nr_pool = 0;
+			}
+			if (res.nr_fields == best) {
+				pool[nr_pool++] = esr;
+			}
+		}
+	}
+
+	return pick(pool, nr_pool);
+}
+
+struct corpus {
+	const char *name;
+	u64 (*gen)(void);
+};
+
+static const struct corpus corpora[] = {
+	{ "weighted", gen_weighted },
+	{ "uniform", gen_uniform },
+	{ "worst", gen_worst },
+};
+
+static const struct corpus *find_corpus(const char *name)
+{
+	for (size_t i = 0; i < sizeof(corpora) / sizeof(corpora[0]); i++) {
+		if (!strcmp(corpora[i].name, name)) {
+			return &corpora[i];
+		}
+	}
+
+	fprintf(stderr, "unknown corpus: %s\n", name);
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *stage, double secs, size_t n, int last)
+{
+	printf("      \"%s\": { \"ns_per_value\": %.2f, "
+	       "\"values_per_sec\": %.0f }%s\n",
+	       stage, secs * 1e9 / n, n / secs, last ? "" : ",");
+}
+
+static void bench_corpus(const struct corpus *c, size_t n, int last)
+{
+	char (*tokens)[BENCH_TOKEN_MAX] = malloc(n * sizeof(*tokens));
+	u64 *vals = malloc(n * sizeof(*vals));
+	struct esr_result *res = malloc(sizeof(*res));
+	u32 *cols = malloc(BENCH_FIELDS * n * sizeof(*cols));
+	struct esr_extract fields[BENCH_FIELDS] = {
+		ESR_EXTRACT_EC(cols),
+		ESR_EXTRACT_IL(cols + n),
+		ESR_EXTRACT_ISS(cols + 2 * n),
+		ESR_EXTRACT_ISS2(cols + 3 * n),
+		ESR_EXTRACT_FSC(cols + 4 * n),
+		ESR_EXTRACT_WNR(cols + 5 * n),
+	};
+	double parse = 0, decode = 0, render = 0, extract = 0;
+	struct outbuf out;
+	u64 sum = 0;
+	int fd;
+
+	/* Rendered text is thrown away, through the buffering stdout gets. */
+	fd = open("/dev/null", O_WRONLY);
+	if (!tokens || !vals || !res || !cols || fd < 0) {
+		perror("bench");
+		exit(1);
+	}
+	outbuf_init(&out, fd, STREAM_BUF_SIZE);
+
+	rng_state = 0x2545f4914f6cdd1dUL;
+	for (size_t i = 0; i < n; i++) {
+		snprintf(tokens[i], BENCH_TOKEN_MAX, "0x%lx", c->gen());
+	}
+
+	/* Best of BENCH_RUNS for every stage. */
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		struct parse_error err;
+		double t0, t1, t2, t3, t4;
+
+		t0 = now();
+		for (size_t i = 0; i < n; i++) {
+			parse_token(tokens[i], strlen(tokens[i]), &vals[i],
+				    &err);
+		}
+
+		t1 = now();
+		for (size_t i = 0; i < n; i++) {
+			esr_decode(vals[i], res);
+			sum += res->nr_fields;
+		}
+
+		t2 = now();
+		for (size_t i = 0; i < n; i++) {
+			esr_decode(vals[i], res);
+			esr_print(&out, res);
+		}
+		outbuf_flush(&out);
+
+		t3 = now();
+		esr_extract(vals, n, fields, BENCH_FIELDS);
+		t4 = now();
+
+		/* The render loop decodes too, count only the printing. */
+		if (!run || t1 - t0 < parse) {
+			parse = t1 - t0;
+		}
+		if (!run || t2 - t1 < decode) {
+			decode = t2 - t1;
+		}
+		if (!run || (t3 - t2) - (t2 - t1) < render) {
+			render = (t3 - t2) - (t2 - t1);
+		}
+		if (!run || t4 - t3 < extract) {
+			extract = t4 - t3;
+		}
+	}
+
+	printf("    {\n");
+	printf("      \"corpus\": \"%s\",\n", c->name);
+	printf("      \"fields\": %lu,\n", sum / BENCH_RUNS);
+	report("parse", parse, n, 0);
+	report("decode", decode, n, 0);
+	report("render", render, n, 0);
+	report("extract", extract, n, 1);
+	printf("    }%s\n", last ? "" : ",");
+
+	outbuf_free(&out);
+	close(fd);
+	free(cols);
+	free(res);
+	free(vals);
+	free(tokens);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: esr_bench [-n VALUES] [--corpus NAME] "
+			"[--gen NAME]\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct corpus *only = NULL;
+	const struct corpus *gen = NULL;
+	size_t n = BENCH_VALUES;
+	size_t nr_corpora;
+
+	for (int i = 1; i < argc; i++) {
+		if (i + 1 == argc) {
+			usage();
+		}
+		if (!strcmp(argv[i], "-n")) {
+			n = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "--corpus")) {
+			only = find_corpus(argv[++i]);
+		} else if (!strcmp(argv[i], "--gen")) {
+			gen = find_corpus(argv[++i]);
+		} else {
+			usage();
+		}
+	}
+
+	if (!n) {
+		usage();
+	}
+
+	/* Write the corpus out for esr_decoder instead of timing it. */
+	if (gen) {
+		for (size_t i = 0; i < n; i++) {
+			printf("0x%lx\n", gen->gen());
+		}
+		return 0;
+	}
+
+	nr_corpora = sizeof(corpora) / sizeof(corpora[0]);
+	printf("{\n");
+	printf("  \"values\": %zu,\n", n);
+	printf("  \"runs\": %d,\n", BENCH_RUNS);
+	printf("  \"results\": [\n");
+	for (size_t i = 0; i < nr_corpora; i++) {
+		if (only && only != &corpora[i]) {
+			continue;
+		}
+		bench_corpus(&corpora[i], n, only || i == nr_corpora - 1);
+	}
+	printf("  ]\n");
+	printf("}\n");
+
+	return 0;
+}
@@ -0,0 +1,191 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * Memo of rendered decodes, keyed by ESR value. Every thread gets its own
+ * cache so lookups never lock: an open addressed table of CACHE_SLOTS entries
+ * pointing into a CACHE_ARENA_SIZE byte text arena. Once the table is half
+ * full or the arena runs out, the whole cache is dropped and refilled, which
+ * bounds its memory without having to track recency. Misses go on to the
+ * --cache-file, if there is one, and new decodes are added to it.
+ */
+#define CACHE_BITS 13
+#define CACHE_SLOTS (1 << CACHE_BITS)
+#define CACHE_ARENA_SIZE (4 << 20)
+
+struct cache_entry {
+	u64 esr;
+	unsigned int offset;
+	/* Zero marks a free slot, a rendered decode is never empty. */
+	unsigned int len;
+};
+
+struct cache {
+	struct cache_entry slots[CACHE_SLOTS];
+	size_t nr_used;
+	/* The entries are dropped when --format changes. */
+	enum output_format format;
+	char *arena;
+	size_t arena_used;
+
+	unsigned long hits;
+	unsigned long misses;
+	struct cache *next;
+};
+
+int cache_enabled = 1;
+
+static __thread struct cache *thread_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Live caches and the counters of the ones whose threads exited, so that
+ * they can be summed up at exit.
+ */
+static struct cache *caches;
+static unsigned long retired_hits;
+static unsigned long retired_misses;
+static pthread_mutex_t caches_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void cache_release(void *arg)
+{
+	struct cache *cache = arg;
+	struct cache **p;
+
+	pthread_mutex_lock(&caches_lock);
+	for (p = &caches; *p != cache; p = &(*p)->next)
+		;
+	*p = cache->next;
+	retired_hits += cache->hits;
+	retired_misses += cache->misses;
+	pthread_mutex_unlock(&caches_lock);
+
+	free(cache->arena);
+	free(cache);
+}
+
+static void cache_key_init(void)
+{
+	pthread_key_create(&cache_key, cache_release);
+}
+
+static void cache_drop(struct cache *cache)
+{
+	memset(cache->slots, 0, sizeof(cache->slots));
+	cache->nr_used = 0;
+	cache->arena_used = 0;
+	cache->format = output_format;
+}
+
+static struct cache *cache_get(void)
+{
+	struct cache *cache = thread_cache;
+
+	if (cache) {
+		if (cache->format != output_format) {
+			cache_drop(cache);
+		}
+		return cache;
+	}
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache || !(cache->arena = malloc(CACHE_ARENA_SIZE))) {
+		perror("malloc");
+		exit(1);
+	}
+	cache->format = output_format;
+
+	pthread_mutex_lock(&caches_lock);
+	cache->next = caches;
+	caches = cache;
+	pthread_mutex_unlock(&caches_lock);
+
+	pthread_once(&cache_key_once, cache_key_init);
+	pthread_setspecific(cache_key, cache);
+
+	thread_cache = cache;
+	return cache;
+}
+
+static size_t cache_hash(u64 esr)
+{
+	/* Fibonacci hashing, the top bits are the best mixed. */
+	return (esr * 0x9e3779b97f4a7c15UL) >> (64 - CACHE_BITS);
+}
+
+const char *cache_lookup(u64 esr, size_t *len)
+{
+	struct cache *cache = cache_get();
+	size_t i = cache_hash(esr);
+	const char *text;
+
+	for (;; i = (i + 1) & (CACHE_SLOTS - 1)) {
+		struct cache_entry *entry = &cache->slots[i];
+
+		if (!entry->len) {
+			break;
+		}
+		if (entry->esr == esr) {
+			cache->hits++;
+			*len = entry->len;
+			return cache->arena + entry->offset;
+		}
+	}
+
+	text = diskcache_lookup(esr, len);
+	if (text) {
+		cache->hits++;
+		return text;
+	}
+
+	cache->misses++;
+	return NULL;
+}
+
+void cache_insert(u64 esr, const char *text, size_t len)
+{
+	struct cache *cache = cache_get();
+	size_t i;
+
+	diskcache_add(esr, text, len);
+
+	if (!len || len > CACHE_ARENA_SIZE) {
+		return;
+	}
+
+	if (cache->nr_used >= CACHE_SLOTS / 2 ||
+	    cache->arena_used + len > CACHE_ARENA_SIZE) {
+		cache_drop(cache);
+	}
+
+	for (i = cache_hash(esr); cache->slots[i].len;
+	     i = (i + 1) & (CACHE_SLOTS - 1)) {
+		if (cache->slots[i].esr == esr) {
+			return;
+		}
+	}
+
+	memcpy(cache->arena + cache->arena_used, text, len);
+	cache->slots[i].esr = esr;
+	cache->slots[i].offset = cache->arena_used;
+	cache->slots[i].len = len;
+	cache->arena_used += len;
+	cache->nr_used++;
+}
+
+void cache_stats(unsigned long *hits, unsigned long *misses)
+{
+	pthread_mutex_lock(&caches_lock);
+	*hits = retired_hits;
+	*misses = retired_misses;
+	for (struct cache *cache = caches; cache; cache = cache->next) {
+		*hits += cache->hits;
+		*misses += cache->misses;
+	}
+	pthread_mutex_unlock(&caches_lock);
+}
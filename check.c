@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * Checks of corners that ordinary input does not reach. No ESR text holds a
+ * '"' or a '\\', so out_json_str() is tried here against a byte at a time
+ * version on every byte value at every position. --filter is tried on RES0,
+ * which is looked up outside the field layouts, and on its range limits.
+ */
+static int failed;
+
+static void json_ref(struct outbuf *ob, const char *s, size_t len)
+{
+	out_char(ob, '"');
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = s[i];
+
+		if (c == '"' || c == '\\') {
+			out_char(ob, '\\');
+			out_char(ob, c);
+		} else if (c < 0x20) {
+			out_lit(ob, "\\u00");
+			out_hex(ob, c, 2);
+		} else {
+			out_char(ob, c);
+		}
+	}
+	out_char(ob, '"');
+}
+
+static void check_json(const char *s, size_t len)
+{
+	struct outbuf got, want;
+
+	outbuf_init(&got, -1, 64);
+	outbuf_init(&want, -1, 64);
+	out_json_str(&got, s, len);
+	json_ref(&want, s, len);
+
+	if (got.len != want.len || memcmp(got.buf, want.buf, got.len)) {
+		printf("out_json_str: %.*s, expected %.*s\n", (int)got.len,
+		       got.buf, (int)want.len, want.buf);
+		failed = 1;
+	}
+
+	outbuf_free(&got);
+	outbuf_free(&want);
+}
+
+static void check_filter(const char *expr, u64 esr, int match)
+{
+	filter_compile(expr);
+	if (filter_match(esr) != match) {
+		printf("--filter '%s' %s 0x%lx\n", expr,
+		       match ? "does not match" : "matches", esr);
+		failed = 1;
+	}
+}
+
+int main(void)
+{
+	static const char quoted[] = "0123456789\"ab\\cd";
+	char s[24];
+
+	check_json(quoted, sizeof(quoted) - 1);
+
+	for (size_t pos = 0; pos < sizeof(s); pos++) {
+		for (unsigned int c = 0; c < 256; c++) {
+			memset(s, 'a', sizeof(s));
+			s[pos] = c;
+			check_json(s, sizeof(s));
+		}
+	}
+
+	/* RES0 in bits 37..63, of a class without RES0 in its layout, */
+	check_filter("RES0", 0x200000000c000000UL, 1);
+	/* in the ISS, after the zero bits 37..63, */
+	check_filter("RES0", 0x96800045, 1);
+	check_filter("RES0 != 0", 0x96800045, 1);
+	/* and nowhere. */
+	check_filter("RES0", 0x96000045, 0);
+	check_filter("RES0", 0x0c000000, 0);
+	check_filter("EC > 0xfffffffffffffffe", 0x96000045, 0);
+
+	if (!failed) {
+		printf("ok\n");
+	}
+	return failed;
+}
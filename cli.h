@@ -0,0 +1,146 @@
+#ifndef CLI_H
+#define CLI_H
+
+#include <stdio.h>
+
+#include "esr.h"
+#include "outbuf.h"
+
+/* Input and stdout buffer size used by the streaming mode. */
+#define STREAM_BUF_SIZE (1 << 20)
+
+/* Lines this long or longer, without the newline, are skipped. */
+#define STREAM_LINE_MAX (STREAM_BUF_SIZE - 1)
+
+/* Upper bound on the text esr_print() renders for a single ESR. */
+#define ESR_TEXT_MAX (16 << 10)
+
+enum output_format {
+	FORMAT_TEXT,
+	FORMAT_JSON,
+	FORMAT_ONELINE,
+};
+
+extern enum output_format output_format;
+
+void esr_print(struct outbuf *out, const struct esr_result *res);
+void esr_print_json(struct outbuf *out, const struct esr_result *res);
+void oneline_render(struct outbuf *out, const char *token, size_t len, u64 esr);
+
+extern int cache_enabled;
+
+const char *cache_lookup(u64 esr, size_t *len);
+void cache_insert(u64 esr, const char *text, size_t len);
+void cache_stats(unsigned long *hits, unsigned long *misses);
+
+int diskcache_open(const char *path);
+const char *diskcache_lookup(u64 esr, size_t *len);
+void diskcache_add(u64 esr, const char *text, size_t len);
+int diskcache_close(void);
+
+extern int summary_enabled;
+extern size_t summary_top;
+
+struct summary_entry {
+	u64 key;
+	/* Zero marks a free slot. */
+	unsigned long count;
+};
+
+enum summary_table {
+	/* --summary */
+	SUMMARY_ESR,
+	/* --kvm-profile */
+	SUMMARY_KVM,
+	NR_SUMMARY_TABLES,
+};
+
+void summary_count(enum summary_table table, u64 key);
+void summary_add(u64 esr);
+size_t summary_sorted(enum summary_table table,
+		      struct summary_entry **entries, unsigned long *total);
+void summary_print(FILE *out);
+
+extern int export_enabled;
+
+int export_open(const char *path);
+void export_add(u64 esr);
+int export_close(void);
+
+enum stats_stage {
+	STAGE_PARSE,
+	STAGE_DECODE,
+	STAGE_RENDER,
+	STAGE_WRITE,
+	NR_STAGES,
+};
+
+extern int stats_enabled;
+extern int stats_json;
+
+u64 stats_clock(void);
+void stats_start(void);
+void stats_stage(enum stats_stage stage, u64 cycles);
+void stats_value(u64 ec);
+void stats_decode(u64 ec, u64 cycles);
+void stats_bytes(unsigned long in, unsigned long out);
+void stats_print(FILE *out);
+
+extern u64 ec_mask;
+
+extern int group_by_signature;
+
+int signature_first(u64 esr);
+void signature_stats(unsigned long *seen, size_t *distinct);
+
+extern int filter_enabled;
+
+void filter_compile(const char *expr);
+int filter_match(u64 esr);
+
+/* Why a token is not a valid ESR, see parse_token(). */
+struct parse_error {
+	const char *msg;
+	/* Offset of the offending character in the token. */
+	size_t pos;
+};
+
+/* Parse bare numbers as decimal instead of hex. */
+extern int parse_decimal;
+/* Set once any token failed to parse. */
+extern int parse_failed;
+
+int parse_token(const char *token, size_t len, u64 *esr,
+		struct parse_error *err);
+void parse_error_print(const char *token, size_t len,
+		       const struct parse_error *err);
+void decode_esr(struct outbuf *out, const char *token, size_t len, u64 esr);
+void decode_token(struct outbuf *out, const char *token);
+void decode_line(struct outbuf *out, char *line, char *end);
+int decode_stream(int fd, const char *name);
+int decode_fd(int fd, const char *name, int nr_threads);
+int decode_file(const char *path, int nr_threads);
+
+/* Renders the lines in [start, end) to @out. */
+typedef void (*render_fn)(struct outbuf *out, char *start, char *end);
+
+struct pool;
+
+struct pool *pool_create(int nr_threads, render_fn render, size_t chunk_size);
+void pool_render(struct pool *pool, char *start, char *end);
+void pool_destroy(struct pool *pool);
+
+void decode_lines(struct outbuf *out, char *start, char *end);
+int decode_stream_parallel(int fd, const char *name, int nr_threads);
+
+int serve(const char *path);
+int serve_client(const char *path, char **tokens, int nr_tokens);
+
+int follow(const char *path);
+int kvm_profile(const char *path, int nr_threads);
+
+int map_file(const char *path, char **map, size_t *size);
+void scan_range(struct outbuf *out, char *start, char *end);
+int scan_file(const char *path, int nr_threads);
+
+#endif
@@ -0,0 +1,327 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+/*
+ * --cache-file FILE: rendered decodes kept across runs. The file is a header,
+ * an open addressed table of slots and the text arena the slots point into.
+ * It is mapped read-only and never changed in place: decodes rendered during
+ * the run are collected in memory and, at exit, written together with the old
+ * ones to a new file that is renamed over the old one. Readers therefore need
+ * no locks, and a run that maps the file keeps a consistent copy whatever
+ * other runs do; when two runs finish together, the last rename wins.
+ *
+ * Slots are keyed by ESR and output format, so runs in different formats
+ * share one file. The header holds a hash of the decoder tables, a file that
+ * does not match is ignored and replaced at exit. Bump DISKCACHE_VERSION when
+ * the file layout or the rendering code's output changes.
+ */
+#define DISKCACHE_MAGIC 0x3165686361637365UL /* "escache1" */
+#define DISKCACHE_VERSION 2
+#define DISKCACHE_MIN_SLOTS 1024
+
+struct diskcache_header {
+	u64 magic;
+	u64 version;
+	u64 nr_slots;
+	u64 nr_used;
+	u64 arena_size;
+};
+
+struct diskcache_slot {
+	u64 esr;
+	u64 offset;
+	/* enum output_format */
+	u32 format;
+	/* Zero marks a free slot, a rendered decode is never empty. */
+	u32 len;
+};
+
+/* The mapped file, if there is a valid one. */
+static const struct diskcache_header *map;
+static size_t map_size;
+static const struct diskcache_slot *map_slots;
+static const char *map_arena;
+
+/* Decodes rendered during this run, not in the file. */
+static struct diskcache_slot *new_slots;
+static size_t nr_new_slots;
+static size_t nr_new;
+static char *new_arena;
+static size_t new_arena_size;
+static size_t new_arena_used;
+static pthread_mutex_t new_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *cache_path;
+static u64 cache_version;
+
+static size_t slot_hash(u64 esr, u32 format, size_t nr_slots)
+{
+	return ((esr ^ (u64)format << 60) * 0x9e3779b97f4a7c15UL) >>
+	       (64 - __builtin_ctzl(nr_slots));
+}
+
+static u64 diskcache_version(void)
+{
+	return esr_tables_hash() ^ DISKCACHE_VERSION * 0x9e3779b97f4a7c15UL;
+}
+
+static int map_valid(const struct diskcache_header *h, size_t size)
+{
+	if (size < sizeof(*h) || h->magic != DISKCACHE_MAGIC ||
+	    h->version != cache_version || h->nr_slots < DISKCACHE_MIN_SLOTS ||
+	    (h->nr_slots & (h->nr_slots - 1)) ||
+	    h->nr_used >= h->nr_slots) {
+		return 0;
+	}
+	return (size - sizeof(*h)) / sizeof(struct diskcache_slot) >=
+		       h->nr_slots &&
+	       size - sizeof(*h) - h->nr_slots * sizeof(struct diskcache_slot) ==
+		       h->arena_size;
+}
+
+int diskcache_open(const char *path)
+{
+	struct stat st;
+	void *p;
+	int fd;
+
+	cache_path = path;
+	cache_version = diskcache_version();
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			return 0;
+		}
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &st)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	if (!st.st_size) {
+		close(fd);
+		return 0;
+	}
+
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	/* Stale or damaged files are rewritten from scratch at exit. */
+	if (!map_valid(p, st.st_size)) {
+		munmap(p, st.st_size);
+		return 0;
+	}
+
+	map = p;
+	map_size = st.st_size;
+	map_slots = (const struct diskcache_slot *)(map + 1);
+	map_arena = (const char *)(map_slots + map->nr_slots);
+	return 0;
+}
+
+const char *diskcache_lookup(u64 esr, size_t *len)
+{
+	size_t mask;
+	size_t i;
+
+	if (!map) {
+		return NULL;
+	}
+
+	/* Bounded, in case the file is damaged. */
+	mask = map->nr_slots - 1;
+	i = slot_hash(esr, output_format, map->nr_slots);
+	for (size_t n = 0; n < map->nr_slots && map_slots[i].len;
+	     n++, i = (i + 1) & mask) {
+		const struct diskcache_slot *slot = &map_slots[i];
+
+		if (slot->esr != esr || slot->format != output_format) {
+			continue;
+		}
+		if (slot->offset > map->arena_size ||
+		    slot->len > map->arena_size - slot->offset) {
+			return NULL;
+		}
+		*len = slot->len;
+		return map_arena + slot->offset;
+	}
+	return NULL;
+}
+
+/* Insert into a table known to have room and not to hold the key. */
+static void slot_insert(struct diskcache_slot *slots, size_t nr_slots,
+			const struct diskcache_slot *slot, u64 offset)
+{
+	size_t i;
+
+	for (i = slot_hash(slot->esr, slot->format, nr_slots); slots[i].len;
+	     i = (i + 1) & (nr_slots - 1))
+		;
+	slots[i] = *slot;
+	slots[i].offset = offset;
+}
+
+static struct diskcache_slot *slots_alloc(size_t n)
+{
+	struct diskcache_slot *slots = calloc(n, sizeof(*slots));
+
+	if (!slots) {
+		perror("malloc");
+		exit(1);
+	}
+	return slots;
+}
+
+static void new_grow(void)
+{
+	struct diskcache_slot *old = new_slots;
+	size_t nr_old = nr_new_slots;
+
+	nr_new_slots = nr_old ? nr_old * 2 : DISKCACHE_MIN_SLOTS;
+	new_slots = slots_alloc(nr_new_slots);
+	for (size_t i = 0; i < nr_old; i++) {
+		if (old[i].len) {
+			slot_insert(new_slots, nr_new_slots, &old[i],
+				    old[i].offset);
+		}
+	}
+	free(old);
+}
+
+void diskcache_add(u64 esr, const char *text, size_t len)
+{
+	struct diskcache_slot slot = { esr, 0, output_format, len };
+	size_t i;
+
+	if (!cache_path || !len || len > ~0U) {
+		return;
+	}
+
+	pthread_mutex_lock(&new_lock);
+
+	/* The per-thread caches forget, and several threads may miss. */
+	for (i = nr_new_slots ? slot_hash(esr, slot.format, nr_new_slots) : 0;
+	     nr_new_slots && new_slots[i].len;
+	     i = (i + 1) & (nr_new_slots - 1)) {
+		if (new_slots[i].esr == esr &&
+		    new_slots[i].format == slot.format) {
+			pthread_mutex_unlock(&new_lock);
+			return;
+		}
+	}
+
+	if (new_arena_size - new_arena_used < len) {
+		new_arena_size = 2 * (new_arena_size + len);
+		new_arena = realloc(new_arena, new_arena_size);
+		if (!new_arena) {
+			perror("malloc");
+			exit(1);
+		}
+	}
+	memcpy(new_arena + new_arena_used, text, len);
+
+	if (++nr_new > nr_new_slots / 2) {
+		new_grow();
+	}
+	slot_insert(new_slots, nr_new_slots, &slot, new_arena_used);
+	new_arena_used += len;
+
+	pthread_mutex_unlock(&new_lock);
+}
+
+/* Write the old and the new decodes to a new file and put it in place. */
+int diskcache_close(void)
+{
+	struct diskcache_header header = { DISKCACHE_MAGIC, cache_version, 0, 0,
+					   0 };
+	size_t old_arena = map ? map->arena_size : 0;
+	size_t old_used = 0;
+	struct diskcache_slot *slots;
+	struct outbuf out;
+	char *tmp;
+	int ret = 0;
+	int fd;
+
+	if (!nr_new) {
+		goto out;
+	}
+
+	/* Not nr_used, the slots are what gets copied. */
+	for (size_t i = 0; map && i < map->nr_slots; i++) {
+		old_used += !!map_slots[i].len;
+	}
+	header.nr_used = old_used + nr_new;
+	header.nr_slots = DISKCACHE_MIN_SLOTS;
+	while (header.nr_slots / 2 < header.nr_used) {
+		header.nr_slots *= 2;
+	}
+	header.arena_size = old_arena + new_arena_used;
+
+	slots = slots_alloc(header.nr_slots);
+	for (size_t i = 0; map && i < map->nr_slots; i++) {
+		if (map_slots[i].len) {
+			slot_insert(slots, header.nr_slots, &map_slots[i],
+				    map_slots[i].offset);
+		}
+	}
+	for (size_t i = 0; i < nr_new_slots; i++) {
+		if (new_slots[i].len) {
+			slot_insert(slots, header.nr_slots, &new_slots[i],
+				    old_arena + new_slots[i].offset);
+		}
+	}
+
+	if (asprintf(&tmp, "%s.%d", cache_path, (int)getpid()) < 0) {
+		perror("malloc");
+		exit(1);
+	}
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+		ret = -1;
+	} else {
+		outbuf_init(&out, fd, STREAM_BUF_SIZE);
+		outbuf_write(&out, &header, sizeof(header));
+		outbuf_write(&out, slots, header.nr_slots * sizeof(*slots));
+		if (map) {
+			outbuf_write(&out, map_arena, old_arena);
+		}
+		outbuf_write(&out, new_arena, new_arena_used);
+		outbuf_flush(&out);
+		outbuf_free(&out);
+
+		if (close(fd) || rename(tmp, cache_path)) {
+			fprintf(stderr, "%s: %s\n", cache_path,
+				strerror(errno));
+			unlink(tmp);
+			ret = -1;
+		}
+	}
+
+	free(tmp);
+	free(slots);
+out:
+	if (map) {
+		munmap((void *)map, map_size);
+		map = NULL;
+	}
+	return ret;
+}
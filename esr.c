@@ -1,23 +1,10 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-typedef unsigned long u64;
-
-static u64 _esr;
-struct bitfield {
-	char *name;
-	char *long_name;
-	size_t start;
-	size_t width;
-	u64 value;
-	char *desc;
-	char *indent;
-	struct bitfield *next;
-	struct bitfield *prev;
-};
+#include "esr.h"
+
+#define BIT(n) (1UL << (n))
+#define GENMASK(h, l) ((~0UL << (l)) & (~0UL >> (63 - (h))))
 
 typedef void (*describe_fn)(struct bitfield *);
+typedef void (*decode_fn)(struct esr_result *);
 
 static u64 get_bits(u64 reg, size_t start, size_t end)
 {
@@ -25,96 +12,36 @@ static u64 get_bits(u64 reg, size_t start, size_t end)
 	return (reg >> start) & ((1 << width) - 1);
 }
 
-static void bitfield_new(u64 reg, char *name, char *long_name, size_t start,
-			 size_t end, describe_fn desc, struct bitfield *field)
+static void bitfield_new(u64 reg, const char *name, const char *long_name,
+			 size_t start, size_t end, describe_fn desc,
+			 struct bitfield *field)
 {
-	memset(field, 0, sizeof(struct bitfield));
 	field->name = name;
 	field->long_name = long_name;
 	field->start = start;
 	field->width = end - start + 1;
 	field->value = get_bits(reg, start, end);
 	field->desc = NULL;
-	field->indent = "";
-	field->next = field;
-	field->prev = field;
 
 	if (desc != NULL) {
 		desc(field);
 	}
 }
 
-static void field_append(struct bitfield *head, struct bitfield *new)
-{
-	new->prev = head->prev;
-	new->next = head;
-	head->prev->next = new;
-	head->prev = new;
-}
-
-static void decimal_to_binary(u64 n, size_t width, char *buf)
-{
-	int i = width - 1;
-	int j = 0;
-
-	if (n == 0) {
-		for (; j < width; j++) {
-			buf[j] = '0';
-		}
-		buf[j] = '\0';
-		return;
-	}
-
-	for (; i >= 0; i--) {
-		int k = (n >> i);
-		buf[j++] = (k & 1) ? '1' : '0';
-	}
-	buf[j] = '\0';
-}
-
-static void field_description(struct bitfield *field)
+static void field_append(struct esr_result *res, struct bitfield *field)
 {
-	char binary[128];
-
-	if (field->width == 1) {
-		printf("%02ld\t", field->start);
-		printf("%s:\t%s", field->name,
-		       field->value == 1 ? "true" : "false");
-	} else {
-		printf("%02ld...%02ld\t", field->start,
-		       field->start + field->width - 1);
-		decimal_to_binary(field->value, field->width, binary);
-		printf("%s:\t0x%02lx 0b%s", field->name, field->value, binary);
-	}
-
-	if (field->long_name) {
-		printf(" (%s)", field->long_name);
+	if (res->nr_fields < ESR_MAX_FIELDS) {
+		res->fields[res->nr_fields++] = *field;
 	}
-
-	if (field->desc) {
-		printf("\t# %s", field->desc);
-	}
-	printf("\n");
 }
 
-static void bitfield_print(struct bitfield *head)
-{
-	field_description(head);
-	for (struct bitfield *p = head->next; p != head; p = p->next) {
-		p->indent = "\t";
-		field_description(p);
-	}
-}
-
-static u64 bitfield_describe(char *name, char *long_name, size_t start,
-			     size_t end, describe_fn desc)
+static u64 bitfield_describe(struct esr_result *res, const char *name,
+			     const char *long_name, size_t start, size_t end,
+			     describe_fn desc)
 {
 	struct bitfield field;
-	bitfield_new(_esr, name, long_name, start, end, desc, &field);
-	bitfield_print(&field);
-	if (desc) {
-		desc(&field);
-	}
+	bitfield_new(res->esr, name, long_name, start, end, desc, &field);
+	field_append(res, &field);
 	return field.value;
 }
 
@@ -127,9 +54,12 @@ static void check_res0(struct bitfield *res0)
 	}
 }
 
-static void describe_res0(size_t start, size_t end)
+static void describe_res0(struct esr_result *res, size_t start, size_t end)
 {
-	bitfield_describe("RES0", "Reserved", start, end, check_res0);
+	if (bitfield_describe(res, "RES0", "Reserved", start, end,
+			      check_res0)) {
+		res->nr_res0_errors++;
+	}
 }
 
 static void describe_il(struct bitfield *field)
@@ -320,7 +250,7 @@ static void describe_fsc(struct bitfield *fsc)
 	}
 }
 
-void describe_set(struct bitfield *set)
+static void describe_set(struct bitfield *set)
 {
 	switch (set->value) {
 	case 0b00:
@@ -462,6 +392,11 @@ static void describe_iss_ld64b(struct bitfield *iss)
 	}
 }
 
+static void describe_bad_iss(struct bitfield *iss)
+{
+	iss->desc = "[ERROR]: bad iss";
+}
+
 static void describe_iord(struct bitfield *iord)
 {
 	if (iord->value == 1) {
@@ -859,884 +794,1003 @@ static void describe_wp_wnr(struct bitfield *wnr)
 	}
 }
 
-static void decode_iss_data_abort(struct bitfield *iss)
+/*
+ * The names of the fields and exception classes. They are pooled in
+ * esr_strings and the tables below hold 16-bit offsets into it instead of
+ * pointers. Where a name is used with more than one long name, the
+ * suffix of the pool entry tells which. An empty string stands for NULL.
+ */
+#define FIELD_STRINGS(S)                                                \
+	S(res0, "RES0", "Reserved")                                     \
+	S(AET, "AET", "Asynchronous Error Type")                        \
+	S(AM, "AM", "Addressing Mode")                                  \
+	S(AorB, "AorB", "A key or B key")                               \
+	S(AR, "AR", "Acquire/Release")                                  \
+	S(BTYPE, "BTYPE", "PSTATE.BTYPE value")                         \
+	S(CM, "CM", "Cache Maintenance")                                \
+	S(CM_gpc, "CM", "Cache maintenance")                            \
+	S(Comment, "Comment",                                           \
+	  "Instruction comment field or immediate field")               \
+	S(COND, "COND", "Condition code of the trapped instruction")    \
+	S(CRm, "CRm", "")                                               \
+	S(CRn, "CRn", "")                                               \
+	S(Crn, "Crn", "")                                               \
+	S(CV, "CV", "Condition code valid")                             \
+	S(DFSC, "DFSC", "Data Fault Status Code")                       \
+	S(DFSC_dabt, "DFSC", "Data Faule Status Code")                  \
+	S(Dir, "Dir", "Direction of the trapped instruction")           \
+	S(DZF, "DZF", "Divide by Zero")                                 \
+	S(EA, "EA", "External Abort type")                              \
+	S(EA_iabt, "EA", "External About type")                         \
+	S(EX, "EX", "Exclusive operation")                              \
+	S(FnP, "FnP", "FAR not Precise")                                \
+	S(FnV, "FnV", "FAR not Valid")                                  \
+	S(GPCSC, "GPCSC", "Granule Protection Check Status Code")       \
+	S(IDF, "IDF", "Input Denomal")                                  \
+	S(IDS, "IDS", "Implementation Defined Syndrome")                \
+	S(IESB, "IESB", "Implicit Error Synchronisation event")         \
+	S(IFSC, "IFSC", "Instruction Fault Status Code")                \
+	S(imm16, "imm16", "Value of the immediate field")               \
+	S(imm8, "imm8", "Immediate value of the trapped instruction")   \
+	S(IMPDEF, "IMPDEF", "Implementation defined")                   \
+	S(InD, "InD", "Instruction or Data access")                     \
+	S(IOF, "IOF", "Invalid Operation")                              \
+	S(IorD, "IorD", "Instruction key or Data key")                  \
+	S(ISS, "ISS", "Instruction Specific Syndrome")                  \
+	S(ISS_ld64b, "ISS", "")                                         \
+	S(ISV, "ISV", "Instruction Syndrome Valid")                     \
+	S(IXF, "IXF", "Inexact")                                        \
+	S(OFF, "OFF", "Overflow")                                       \
+	S(Offset, "Offset",                                             \
+	  "Whether the offset is added or substracted")                 \
+	S(Op0, "Op0", "")                                               \
+	S(Op1, "Op1", "")                                               \
+	S(Op2, "Op2", "")                                               \
+	S(Opc1, "Opc1", "")                                             \
+	S(Opc2, "Opc2", "")                                             \
+	S(Rd, "Rd",                                                     \
+	  "General-purpose register number used for the "               \
+	  "destination")                                                \
+	S(RN, "RN", "Register Number")                                  \
+	S(Rn, "Rn",                                                     \
+	  "General-purpose register number of the trapped "             \
+	  "instruction")                                                \
+	S(Rt, "Rt", "")                                                 \
+	S(Rt2, "Rt2", "")                                               \
+	S(Rt_msr, "Rt",                                                 \
+	  "General-purpose register number of the trapped "             \
+	  "instruction")                                                \
+	S(RV, "RV", "Register valid")                                   \
+	S(S1PTW, "S1PTW", "Stage-1 translation table walk")             \
+	S(S2PTW, "S2PTW", "Stage-2 translation table walk")             \
+	S(SAS, "SAS", "Syndrome Access Size")                           \
+	S(SET, "SET", "Synchronous Error Type")                         \
+	S(SF, "SF", "Sixty-Four")                                       \
+	S(SMTC, "SMTC", "SME Trap Code")                                \
+	S(SRT, "SRT", "Syndrome Register Transfer")                     \
+	S(SSE, "SSE", "Syndrome Sign Extend")                           \
+	S(TFV, "TFV", "Trapped Fault Valid")                            \
+	S(TI, "TI", "Trapped Instruction")                              \
+	S(UFF, "UFF", "Underflow")                                      \
+	S(VECITR, "VECITR", "RES1 or UNKNOWN")                          \
+	S(VNCR, "VNCR", "")                                             \
+	S(WnR, "WnR", "Write not Read")                                 \
+	S(WnR_gpc, "WnR", "Write or Read")                              \
+	S(WPF, "WPF", "Watchpoint might be false-positive")             \
+	S(WPT, "WPT", "Watchpoint number")                              \
+	S(WPTV, "WPTV", "Watchpoint number Valid")                      \
+	S(xFSC, "xFSC", "Instruction or Data Fault Status Code")
+
+#define CLASS_STRINGS(S)                                                \
+	S(UNKNOWN, "Unknown reason")                                    \
+	S(WFx, "Wrapped WF* instruction execution")                     \
+	S(CP15_32, "Trapped MCR or MRC access with coproc = 0b1111")    \
+	S(CP15_64, "Trapped MCRR or MRRC access with coproc = 0b1111")  \
+	S(CP14_MR, "Trapped MCR or MRC access with coproc = 0b1110")    \
+	S(CP14_LS, "Trapped LDC or STC access")                         \
+	S(FP_ASIMD,                                                     \
+	  "Trapped access to SVE, Advanced SIMD or floating "           \
+	  "point")                                                      \
+	S(LS64,                                                         \
+	  "Trapped execution of an LD64B, ST64B, ST64BV, or "           \
+	  "ST64BV0 instruction")                                        \
+	S(CP14_64, "Trapped MRRC access with coproc == 0b1110")         \
+	S(BTI, "Branch Target Exception")                               \
+	S(ILL, "Illegal Execution state")                               \
+	S(SVC32, "SVC instruction execution in AArch32 state")          \
+	S(SVC64, "SVC instruction execution in AArch64 state")          \
+	S(HVC64, "HVC instruction execution in AArch64 state")          \
+	S(SMC64, "SMC instruction execution in AArch64 state")          \
+	S(SYS64,                                                        \
+	  "Trapped MSR, MRS or System instruction execution in "        \
+	  "AArch64 state")                                              \
+	S(SVE,                                                          \
+	  "Access to SVE functionality trapped as a result of "         \
+	  "CPACR_EL1.ZEN, CPTR_EL2.ZEN, CPTR_EL2.TZ, or "               \
+	  "CPTR_EL3.EZ")                                                \
+	S(TSTART,                                                       \
+	  "Exception from an access to a TSTART instruction at "        \
+	  "EL0 when SCTLR_EL1.TME0 == 0, EL0 when "                     \
+	  "SCTLR_EL2.TME0 == 0, at EL1 when SCTLR_EL1.TME == 0, "       \
+	  "at EL2 when SCTLR_EL2.TME == 0 or at EL3 when "              \
+	  "SCTLR_EL3.TME == 0")                                         \
+	S(FPAC,                                                         \
+	  "Exception from a Pointer Authentication instruction "        \
+	  "authentication failure")                                     \
+	S(SME,                                                          \
+	  "Access to SME functionality trapped as a result of "         \
+	  "CPACR_EL1.SMEN, CPTR_EL2.SMEN, CPTR_EL2.TSM, "               \
+	  "CPTR_EL3.ESM, or an attempted execution of an "              \
+	  "instruction that is illegal because of the value of "        \
+	  "PSTATE.SM or PSTATE.ZA")                                     \
+	S(GPC, "Exception from a Granule Protection Check")             \
+	S(IABT_LOW, "Instruction Abort from a lower Exception level")   \
+	S(IABT_CUR,                                                     \
+	  "Instruction Abort taken without a change in "                \
+	  "Exception level")                                            \
+	S(PC_ALIGN, "PC alignment fault exception")                     \
+	S(DABT_LOW, "Data Abort from a lower Exception level")          \
+	S(DABT_CUR,                                                     \
+	  "Data Abort taken without a change in Exception level")       \
+	S(SP_ALIGN, "SP alignment fault exception")                     \
+	S(FP_EXC32,                                                     \
+	  "Trapped floating-ppint exception taken from AArch32 "        \
+	  "state")                                                      \
+	S(FP_EXC64,                                                     \
+	  "Trapped floating-ppint exception taken from AArch64 "        \
+	  "state")                                                      \
+	S(SERROR, "SError interrupt")                                   \
+	S(BREAKPT_LOW,                                                  \
+	  "Breakpoint execution from a lower Exception level")          \
+	S(BREAKPT_CUR,                                                  \
+	  "Breakpoint exception taken without a change in "             \
+	  "Exception level")                                            \
+	S(SOFTSTP_LOW,                                                  \
+	  "Software Step exception from a lower Exception level")       \
+	S(SOFTSTP_CUR,                                                  \
+	  "Software Step exception taken without a change in "          \
+	  "Exception level")                                            \
+	S(WATCHPT_LOW,                                                  \
+	  "Watchpoint exception from a lower Exception level")          \
+	S(WATCHPT_CUR,                                                  \
+	  "Watchpoint exception taken without a change in "             \
+	  "Exception level")                                            \
+	S(BKPT32, "BKPT instruction execution in AArch32 state")        \
+	S(BRK64, "BRK instruction execution in AArch64 state")
+
+#define FIELD_STRING(id, n, ln) char id[sizeof(n)], id##_long[sizeof(ln)];
+#define CLASS_STRING(id, d) \
+	char ec_##id[sizeof(#id)], ec_##id##_desc[sizeof(d)];
+#define FIELD_INIT(id, n, ln) n, ln,
+#define CLASS_INIT(id, d) #id, d,
+
+static const struct esr_strings {
+	char null[1];
+	char bad_ec[sizeof("[ERROR]: bad ec")];
+	FIELD_STRINGS(FIELD_STRING)
+	CLASS_STRINGS(CLASS_STRING)
+} esr_strings = {
+	"",
+	"[ERROR]: bad ec",
+	FIELD_STRINGS(FIELD_INIT)
+	CLASS_STRINGS(CLASS_INIT)
+};
+
+#define STR(member) offsetof(struct esr_strings, member)
+
+static const char *pool_str(unsigned short offset)
 {
-	struct bitfield fsc;
+	const char *s = (const char *)&esr_strings + offset;
 
-	u64 isv = bitfield_describe("ISV", "Instruction Syndrome Valid", 24, 24,
-				    NULL);
+	return *s ? s : NULL;
+}
 
-	if (isv == 1) {
-		bitfield_describe("SAS", "Syndrome Access Size", 22, 23,
-				  describe_sas);
-		bitfield_describe("SSE", "Syndrome Sign Extend", 21, 21, NULL);
-		bitfield_describe("SRT", "Syndrome Register Transfer", 16, 20,
-				  NULL);
-		bitfield_describe("SF", "Sixty-Four", 15, 15, NULL);
-		bitfield_describe("AR", "Acquire/Release", 14, 14, describe_ar);
-	} else {
-		describe_res0(14, 23);
-	}
+/* What struct esr_field says, with the names in esr_strings. */
+struct field_layout {
+	unsigned short name;
+	unsigned short long_name;
+	unsigned char start;
+	unsigned char end;
+	unsigned char flags;
+	/* Every condition is on ISS bits. */
+	u32 if_mask;
+	u32 if_value;
+	u32 unless_mask;
+	u32 unless_value;
+	describe_fn describe;
+};
 
-	bitfield_describe("VNCR", NULL, 13, 13, NULL);
+/*
+ * Field layouts of the exception classes, in print order. A field with a
+ * WHEN() condition is only there when the ESR bits under the mask have that
+ * value, and one with UNLESS() only when they do not; the two combine.
+ */
+#define WHEN(mask, value) .if_mask = (mask), .if_value = (value)
+#define UNLESS(mask, value) .unless_mask = (mask), .unless_value = (value)
+
+#define FIELD(id, s, e, d, ...)                                         \
+	{                                                               \
+		.name = STR(id), .long_name = STR(id##_long),           \
+		.start = (s), .end = (e), .describe = (d), __VA_ARGS__  \
+	}
+#define RES0(s, e, ...)                                                 \
+	FIELD(res0, s, e, check_res0, .flags = ESR_FIELD_RES0, __VA_ARGS__)
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/* Instruction and data aborts */
+#define FSC_SEA WHEN(GENMASK(5, 0), 0b010000)
+#define NOT_FSC_SEA UNLESS(GENMASK(5, 0), 0b010000)
+
+/* SError */
+#define IDS_SET WHEN(BIT(24), BIT(24))
+#define IDS_CLEAR WHEN(BIT(24), 0)
+#define DFSC_UNCATEGORIZED WHEN(BIT(24) | GENMASK(5, 0), 0b010001)
+#define NOT_DFSC_UNCATEGORIZED UNLESS(GENMASK(5, 0), 0b010001)
+
+static const struct field_layout data_abort_fields[] = {
+	FIELD(ISV, 24, 24, NULL),
+	FIELD(SAS, 22, 23, describe_sas, WHEN(BIT(24), BIT(24))),
+	FIELD(SSE, 21, 21, NULL, WHEN(BIT(24), BIT(24))),
+	FIELD(SRT, 16, 20, NULL, WHEN(BIT(24), BIT(24))),
+	FIELD(SF, 15, 15, NULL, WHEN(BIT(24), BIT(24))),
+	FIELD(AR, 14, 14, describe_ar, WHEN(BIT(24), BIT(24))),
+	RES0(14, 23, WHEN(BIT(24), 0)),
+	FIELD(VNCR, 13, 13, NULL),
+	FIELD(SET, 11, 12, describe_set, FSC_SEA),
+	RES0(11, 12, NOT_FSC_SEA),
+	FIELD(FnV, 10, 10, describe_fnv),
+	FIELD(EA, 9, 9, NULL),
+	FIELD(CM, 8, 8, NULL),
+	FIELD(S1PTW, 7, 7, describe_s1ptw),
+	FIELD(WnR, 6, 6, describe_wnr),
+	FIELD(DFSC_dabt, 0, 5, describe_fsc),
+};
 
-	bitfield_new(iss->value, "DFSC", "Data Faule Status Code", 0, 5,
-		     describe_fsc, &fsc);
+static const struct field_layout res0_fields[] = {
+	RES0(0, 24),
+};
 
-	if (fsc.value == 0b010000) {
-		bitfield_describe("SET", "Synchronous Error Type", 11, 12,
-				  describe_set);
-	} else {
-		describe_res0(11, 12);
-	}
+static const struct field_layout wf_fields[] = {
+	FIELD(CV, 24, 24, decribe_cv),
+	FIELD(COND, 20, 23, NULL),
+	RES0(10, 19),
+	FIELD(RN, 5, 9, NULL),
+	RES0(3, 4),
+	FIELD(RV, 2, 2, describe_rv),
+	FIELD(TI, 0, 1, describe_ti),
+};
 
-	bitfield_describe("FnV", "FAR not Valid", 10, 10, describe_fnv);
-	bitfield_describe("EA", "External Abort type", 9, 9, NULL);
-	bitfield_describe("CM", "Cache Maintenance", 8, 8, NULL);
-	bitfield_describe("S1PTW", "Stage-1 translation table walk", 7, 7,
-			  describe_s1ptw);
-	bitfield_describe("WnR", "Write not Read", 6, 6, describe_wnr);
-	bitfield_print(&fsc);
-}
+static const struct field_layout mcr_fields[] = {
+	FIELD(CV, 24, 24, decribe_cv),
+	FIELD(COND, 20, 23, NULL),
+	FIELD(Opc2, 17, 19, NULL),
+	FIELD(Opc1, 14, 16, NULL),
+	FIELD(Crn, 10, 13, NULL),
+	FIELD(Rt, 5, 9, NULL),
+	FIELD(CRm, 1, 4, NULL),
+	FIELD(Dir, 0, 0, describe_mcr_direction),
+};
 
-static void decode_iss_res0(struct bitfield *iss)
-{
-	describe_res0(0, 24);
-}
+static const struct field_layout mcrr_fields[] = {
+	FIELD(CV, 24, 24, describe_cv),
+	FIELD(COND, 20, 23, NULL),
+	FIELD(Opc1, 16, 19, NULL),
+	RES0(15, 15),
+	FIELD(Rt2, 10, 14, NULL),
+	FIELD(Rt, 5, 9, NULL),
+	FIELD(CRm, 1, 4, NULL),
+	FIELD(Dir, 0, 0, describe_mcr_direction),
+};
 
-static void decode_iss_wf(struct bitfield *iss)
-{
-	bitfield_describe("CV", "Condition code valid", 24, 24, decribe_cv);
-	bitfield_describe("COND", "Condition code of the trapped instruction",
-			  20, 23, NULL);
-	describe_res0(10, 19);
-	bitfield_describe("RN", "Register Number", 5, 9, NULL);
-	describe_res0(3, 4);
-	bitfield_describe("RV", "Register valid", 2, 2, describe_rv);
-	bitfield_describe("TI", "Trapped Instruction", 0, 1, describe_ti);
-}
+static const struct field_layout ldc_fields[] = {
+	FIELD(CV, 24, 24, describe_cv),
+	FIELD(COND, 20, 23, NULL),
+	FIELD(imm8, 12, 19, NULL),
+	RES0(10, 11),
+	FIELD(Rn, 5, 9, NULL),
+	FIELD(Offset, 4, 4, describe_offset),
+	FIELD(AM, 1, 3, describe_am),
+	FIELD(Dir, 0, 0, describe_ldc_direction),
+};
+
+static const struct field_layout sve_fields[] = {
+	FIELD(CV, 24, 24, describe_cv),
+	FIELD(COND, 20, 23, NULL),
+	RES0(0, 19),
+};
 
-static void decode_iss_mcr(struct bitfield *iss)
+static const struct field_layout ld64b_fields[] = {
+	FIELD(ISS_ld64b, 0, 24, describe_iss_ld64b),
+};
+
+static const struct field_layout bti_fields[] = {
+	RES0(2, 24),
+	FIELD(BTYPE, 0, 1, NULL),
+};
+
+static const struct field_layout hvc_fields[] = {
+	RES0(16, 24),
+	FIELD(imm16, 0, 15, NULL),
+};
+
+static const struct field_layout msr_fields[] = {
+	RES0(22, 24),
+	FIELD(Op0, 20, 21, NULL),
+	FIELD(Op2, 17, 19, NULL),
+	FIELD(Op1, 14, 16, NULL),
+	FIELD(CRn, 10, 13, NULL),
+	FIELD(Rt_msr, 5, 9, NULL),
+	FIELD(CRm, 1, 4, NULL),
+	FIELD(Dir, 0, 0, describe_msr_direction),
+};
+
+static const struct field_layout tstart_fields[] = {
+	RES0(10, 24),
+	FIELD(Rd, 5, 9, NULL),
+	RES0(0, 4),
+};
+
+static const struct field_layout pauth_fields[] = {
+	RES0(2, 24),
+	FIELD(IorD, 1, 1, describe_iord),
+	FIELD(AorB, 0, 0, describe_aorb),
+};
+
+static const struct field_layout sme_fields[] = {
+	RES0(3, 24),
+	FIELD(SMTC, 0, 2, describe_smtc),
+};
+
+static const struct field_layout gpc_fields[] = {
+	RES0(22, 24),
+	FIELD(S2PTW, 21, 21, describe_s2ptw),
+	FIELD(InD, 20, 20, describe_ind),
+	FIELD(GPCSC, 14, 19, describe_gpcsc),
+	FIELD(VNCR, 13, 13, describe_vncr),
+	RES0(11, 12),
+	RES0(9, 10),
+	FIELD(CM_gpc, 8, 8, describe_cm),
+	FIELD(S1PTW, 7, 7, describe_s1ptw),
+	RES0(6, 6, WHEN(BIT(20), BIT(20))),
+	FIELD(WnR_gpc, 6, 6, describe_gpc_wnr, WHEN(BIT(20), 0)),
+	FIELD(xFSC, 0, 5, describe_xfsc),
+};
+
+static const struct field_layout default_fields[] = {
+	FIELD(ISS, 0, 24, describe_bad_iss),
+};
+
+static const struct field_layout instruction_abort_fields[] = {
+	RES0(13, 24),
+	FIELD(SET, 11, 12, describe_set, FSC_SEA),
+	RES0(11, 12, NOT_FSC_SEA),
+	FIELD(FnV, 10, 10, describe_fnv),
+	FIELD(EA_iabt, 9, 9, NULL),
+	RES0(8, 8),
+	FIELD(S1PTW, 7, 7, describe_s1ptw),
+	RES0(6, 6),
+	FIELD(IFSC, 0, 5, describe_fsc),
+};
+
+static const struct field_layout fp_fields[] = {
+	RES0(24, 24),
+	FIELD(TFV, 23, 23, describe_tfv),
+	RES0(11, 22),
+	FIELD(VECITR, 8, 10, NULL),
+	FIELD(IDF, 7, 7, describe_idf),
+	RES0(5, 6),
+	FIELD(IXF, 4, 4, describe_ixf),
+	FIELD(UFF, 3, 3, describe_uff),
+	FIELD(OFF, 2, 2, describe_off),
+	FIELD(DZF, 1, 1, describe_dzf),
+	FIELD(IOF, 0, 0, describe_iof),
+};
+
+static const struct field_layout serror_fields[] = {
+	FIELD(IDS, 24, 24, describe_ids),
+	FIELD(IMPDEF, 0, 23, NULL, IDS_SET),
+	RES0(14, 23, IDS_CLEAR),
+	FIELD(IESB, 13, 13, describe_iesb, DFSC_UNCATEGORIZED),
+	RES0(13, 13, IDS_CLEAR, NOT_DFSC_UNCATEGORIZED),
+	FIELD(AET, 10, 12, describe_aet, IDS_CLEAR),
+	FIELD(EA, 9, 9, NULL, DFSC_UNCATEGORIZED),
+	RES0(9, 9, IDS_CLEAR, NOT_DFSC_UNCATEGORIZED),
+	RES0(6, 8, IDS_CLEAR),
+	FIELD(DFSC, 0, 5, describe_serror_dfsc, IDS_CLEAR),
+};
+
+static const struct field_layout breakpoint_vector_catch_fields[] = {
+	RES0(6, 24),
+	FIELD(IFSC, 0, 5, describe_debug_fsc),
+};
+
+static const struct field_layout software_step_fields[] = {
+	FIELD(ISV, 24, 24, describe_isv),
+	RES0(7, 23),
+	FIELD(EX, 6, 6, describe_ex, WHEN(BIT(24), BIT(24))),
+	RES0(6, 6, WHEN(BIT(24), 0)),
+	FIELD(IFSC, 0, 5, describe_debug_fsc),
+};
+
+static const struct field_layout watchpoint_fields[] = {
+	RES0(24, 24),
+	FIELD(WPT, 18, 23, NULL),
+	FIELD(WPTV, 17, 17, describe_wptv),
+	FIELD(WPF, 16, 16, describe_wpf),
+	FIELD(FnP, 15, 15, describe_fnp),
+	RES0(14, 14),
+	FIELD(VNCR, 13, 13, describe_wp_vncr),
+	RES0(11, 12),
+	FIELD(FnV, 10, 10, describe_wp_fnv),
+	RES0(9, 9),
+	FIELD(CM, 8, 8, describe_wp_cm),
+	RES0(7, 7),
+	FIELD(WnR, 6, 6, describe_wp_wnr),
+	FIELD(DFSC, 0, 5, describe_debug_fsc),
+};
+
+static const struct field_layout breakpoint_fields[] = {
+	RES0(16, 24),
+	FIELD(Comment, 0, 15, NULL),
+};
+
+/* The 16-bit op0:op1:CRn:CRm:op2 encoding of an MSR/MRS system register. */
+#define SYS_REG(op0, op1, crn, crm, op2) \
+	(((op0) << 14) | ((op1) << 11) | ((crn) << 7) | ((crm) << 3) | (op2))
+
+#include "sysreg-table.h"
+
+const char *esr_sysreg_name(u64 op0, u64 op1, u64 op2, u64 crn, u64 crm)
 {
-	bitfield_describe("CV", "Condition code valid", 24, 24, decribe_cv);
-	bitfield_describe("COND", "Condition code of the trapped instruction",
-			  20, 23, NULL);
-	bitfield_describe("Opc2", NULL, 17, 19, NULL);
-	bitfield_describe("Opc1", NULL, 14, 17, NULL);
-	bitfield_describe("Crn", NULL, 10, 13, NULL);
-	bitfield_describe("Rt", NULL, 5, 9, NULL);
-	bitfield_describe("CRm", NULL, 1, 4, NULL);
-	bitfield_describe("Dir", "Direction of the trapped instruction", 0, 0,
-			  describe_mcr_direction);
-}
-
-static void decode_iss_mcrr(struct bitfield *iss)
-{
-	bitfield_describe("CV", "Condition code valid", 24, 24, describe_cv);
-	bitfield_describe("COND", "Condition code of the trapped instruction",
-			  20, 23, NULL);
-	bitfield_describe("Opc1", NULL, 16, 19, NULL);
-	describe_res0(15, 15);
-	bitfield_describe("Rt2", NULL, 10, 14, NULL);
-	bitfield_describe("Rt", NULL, 5, 9, NULL);
-	bitfield_describe("CRm", NULL, 1, 4, NULL);
-	bitfield_describe("Dir", "Direction of the trapped instruction", 0, 0,
-			  describe_mcr_direction);
-}
-
-static void decode_iss_ldc(struct bitfield *iss)
-{
-	bitfield_describe("CV", "Condition code valid", 24, 24, describe_cv);
-	bitfield_describe("COND", "Condition code of the trapped instruction",
-			  20, 23, NULL);
-	bitfield_describe("imm8", "Immediate value of the trapped instruction",
-			  12, 19, NULL);
-	describe_res0(10, 11);
-	bitfield_describe(
-		"Rn",
-		"General-purpose register number of the trapped instruction", 5,
-		9, NULL);
-	bitfield_describe("Offset",
-			  "Whether the offset is added or substracted", 4, 4,
-			  describe_offset);
-	bitfield_describe("AM", "Addressing Mode", 1, 3, describe_am);
-	bitfield_describe("Dir", "Direction of the trapped instruction", 0, 0,
-			  describe_ldc_direction);
-}
-
-static void decode_iss_sve(struct bitfield *iss)
-{
-	bitfield_describe("CV", "Condition code valid", 24, 24, describe_cv);
-	bitfield_describe("COND", "Condition code of the trapped instruction",
-			  20, 23, NULL);
-	describe_res0(0, 19);
-}
-
-static void decode_iss_ld64b(struct bitfield *iss)
-{
-	bitfield_describe("ISS", NULL, 0, 24, describe_iss_ld64b);
-}
-
-static void decode_iss_bti(struct bitfield *iss)
-{
-	describe_res0(2, 24);
-	bitfield_describe("BTYPE", "PSTATE.BTYPE value", 0, 1, NULL);
-}
-
-static void decode_iss_hvc(struct bitfield *iss)
-{
-	describe_res0(16, 24);
-	bitfield_describe("imm16", "Value of the immediate field", 0, 15, NULL);
-}
-
-#define SYSREG_INDEX(op0, crn, op1, crm, op2) \
-	((op0 << 20) | (crn << 10) | (op1 << 14) | (crm << 1) | (op2 << 17))
-
-char *sysreg_name(u64 op0, u64 op1, u64 op2, u64 crn, u64 crm)
-{
-	switch (SYSREG_INDEX(op0, crn, op1, crm, op2)) {
-	case SYSREG_INDEX(3, 1, 0, 0, 1):
-		return "ACTLR_EL1";
-	case SYSREG_INDEX(3, 1, 4, 0, 1):
-		return "ACTLR_EL2";
-	case SYSREG_INDEX(3, 1, 6, 0, 1):
-		return "ACTLR_EL3";
-	case SYSREG_INDEX(3, 0, 1, 0, 7):
-		return "AIDR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 1, 0):
-		return "AFSR0_EL1";
-	case SYSREG_INDEX(3, 5, 4, 1, 0):
-		return "AFSR0_EL2";
-	case SYSREG_INDEX(3, 5, 6, 1, 0):
-		return "AFSR0_EL3";
-	case SYSREG_INDEX(3, 5, 0, 1, 1):
-		return "AFSR1_EL1";
-	case SYSREG_INDEX(3, 5, 4, 1, 1):
-		return "AFSR1_EL2";
-	case SYSREG_INDEX(3, 5, 6, 1, 1):
-		return "AFSR1_EL3";
-	case SYSREG_INDEX(3, 10, 0, 3, 0):
-		return "AMAIR_EL1";
-	case SYSREG_INDEX(3, 10, 4, 3, 0):
-		return "AMAIR_EL2";
-	case SYSREG_INDEX(3, 10, 6, 3, 0):
-		return "AMAIR_EL3";
-	case SYSREG_INDEX(3, 0, 1, 0, 0):
-		return "CCSIDR_EL1";
-	case SYSREG_INDEX(3, 0, 1, 0, 1):
-		return "CLIDR_EL1";
-	case SYSREG_INDEX(3, 1, 0, 0, 2):
-		return "CPACR_EL1";
-	case SYSREG_INDEX(3, 1, 4, 1, 2):
-		return "CPTR_EL2";
-	case SYSREG_INDEX(3, 1, 6, 1, 2):
-		return "CPTR_EL3";
-	case SYSREG_INDEX(3, 0, 2, 0, 0):
-		return "CSSELR_EL1";
-	case SYSREG_INDEX(3, 0, 3, 0, 1):
-		return "CTR_EL0";
-	case SYSREG_INDEX(3, 12, 0, 1, 1):
-		return "DISR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 3, 0):
-		return "ERRIDR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 3, 1):
-		return "ERRSELR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 4, 3):
-		return "ERXADDR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 4, 1):
-		return "ERXCTLR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 4, 0):
-		return "ERXFR_EL1";
-	case SYSREG_INDEX(3, 5, 0, 5, 0):
-		return "ERXMISC0_EL1";
-	case SYSREG_INDEX(3, 5, 0, 5, 1):
-		return "ERXMISC1_EL1";
-	case SYSREG_INDEX(3, 5, 0, 4, 2):
-		return "ERXSTATUS_EL1";
-	case SYSREG_INDEX(3, 5, 0, 2, 0):
-		return "ESR_EL1";
-	case SYSREG_INDEX(3, 5, 4, 2, 0):
-		return "ESR_EL2";
-	case SYSREG_INDEX(3, 5, 6, 2, 0):
-		return "ESR_EL3";
-	case SYSREG_INDEX(3, 1, 4, 1, 7):
-		return "HACR_EL2";
-	case SYSREG_INDEX(3, 1, 4, 1, 0):
-		return "HCR_EL2";
-	case SYSREG_INDEX(3, 0, 0, 1, 3):
-		return "ID_AFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 2):
-		return "ID_DFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 0):
-		return "ID_ISAR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 1):
-		return "ID_ISAR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 2):
-		return "ID_ISAR2_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 3):
-		return "ID_ISAR3_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 4):
-		return "ID_ISAR4_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 5):
-		return "ID_ISAR5_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 7):
-		return "ID_ISAR6_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 4):
-		return "ID_MMFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 5):
-		return "ID_MMFR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 6):
-		return "ID_MMFR2_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 7):
-		return "ID_MMFR3_EL1";
-	case SYSREG_INDEX(3, 0, 0, 2, 6):
-		return "ID_MMFR4_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 0):
-		return "ID_PFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 1, 1):
-		return "ID_PFR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 3, 4):
-		return "ID_PFR2_EL1";
-	case SYSREG_INDEX(3, 0, 0, 5, 0):
-		return "ID_AA64DFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 6, 0):
-		return "ID_AA64ISAR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 6, 1):
-		return "ID_AA64ISAR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 7, 0):
-		return "ID_AA64MMFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 7, 1):
-		return "ID_AA64MMFR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 7, 2):
-		return "ID_AA64MMFR2_EL1";
-	case SYSREG_INDEX(3, 0, 0, 4, 0):
-		return "ID_AA64PFR0_EL1";
-	case SYSREG_INDEX(3, 5, 4, 0, 1):
-		return "IFSR32_EL2";
-	case SYSREG_INDEX(3, 10, 0, 4, 3):
-		return "LORC_EL1";
-	case SYSREG_INDEX(3, 10, 0, 4, 7):
-		return "LORID_EL1";
-	case SYSREG_INDEX(3, 10, 0, 4, 2):
-		return "LORN_EL1";
-	case SYSREG_INDEX(3, 1, 6, 3, 1):
-		return "MDCR_EL3";
-	case SYSREG_INDEX(3, 0, 0, 0, 0):
-		return "MIDR_EL1";
-	case SYSREG_INDEX(3, 0, 0, 0, 5):
-		return "MPIDR_EL1";
-	case SYSREG_INDEX(3, 7, 0, 4, 0):
-		return "PAR_EL1";
-	case SYSREG_INDEX(3, 12, 6, 0, 1):
-		return "RVBAR_EL3";
-	case SYSREG_INDEX(3, 0, 0, 0, 6):
-		return "REVIDR_EL1";
-	case SYSREG_INDEX(3, 1, 0, 0, 0):
-		return "SCTLR_EL1";
-	case SYSREG_INDEX(3, 1, 6, 0, 0):
-		return "SCTLR_EL3";
-	case SYSREG_INDEX(3, 2, 0, 0, 2):
-		return "TCR_EL1";
-	case SYSREG_INDEX(3, 2, 4, 0, 2):
-		return "TCR_EL2";
-	case SYSREG_INDEX(3, 2, 6, 0, 2):
-		return "TCR_EL3";
-	case SYSREG_INDEX(3, 2, 0, 0, 0):
-		return "TTBR0_EL1";
-	case SYSREG_INDEX(3, 2, 4, 0, 0):
-		return "TTBR0_EL2";
-	case SYSREG_INDEX(3, 2, 6, 0, 0):
-		return "TTBR0_EL3";
-	case SYSREG_INDEX(3, 2, 0, 0, 1):
-		return "TTBR1_EL1";
-	case SYSREG_INDEX(3, 2, 4, 0, 1):
-		return "TTBR1_EL2";
-	case SYSREG_INDEX(3, 12, 4, 1, 1):
-		return "VDISR_EL2";
-	case SYSREG_INDEX(3, 5, 4, 2, 3):
-		return "VSESR_EL2";
-	case SYSREG_INDEX(3, 2, 4, 1, 2):
-		return "VTCR_EL2";
-	case SYSREG_INDEX(3, 2, 4, 1, 0):
-		return "VTTBR_EL2";
-	case SYSREG_INDEX(3, 5, 5, 1, 0):
-		return "AFSR0_EL12";
-	case SYSREG_INDEX(3, 5, 5, 1, 1):
-		return "AFSR1_EL12";
-	case SYSREG_INDEX(3, 10, 5, 3, 0):
-		return "AMAIR_EL12";
-	case SYSREG_INDEX(3, 14, 3, 0, 0):
-		return "CNTFRQ_EL0";
-	case SYSREG_INDEX(3, 14, 4, 1, 0):
-		return "CNTHCTL_EL2";
-	case SYSREG_INDEX(3, 14, 4, 2, 1):
-		return "CNTHP_CTL_EL2";
-	case SYSREG_INDEX(3, 14, 4, 2, 2):
-		return "CNTHP_CVAL_EL2";
-	case SYSREG_INDEX(3, 14, 4, 2, 0):
-		return "CNTHP_TVAL_EL2";
-	case SYSREG_INDEX(3, 14, 4, 3, 1):
-		return "CNTHV_CTL_EL2";
-	case SYSREG_INDEX(3, 14, 4, 3, 2):
-		return "CNTHV_CVAL_EL2";
-	case SYSREG_INDEX(3, 14, 4, 3, 0):
-		return "CNTHV_TVAL_EL2";
-	case SYSREG_INDEX(3, 14, 0, 1, 0):
-		return "CNTKCTL_EL1";
-	case SYSREG_INDEX(3, 14, 5, 1, 0):
-		return "CNTKCTL_EL12";
-	case SYSREG_INDEX(3, 14, 3, 2, 1):
-		return "CNTP_CTL_EL0";
-	case SYSREG_INDEX(3, 14, 5, 2, 1):
-		return "CNTP_CTL_EL02";
-	case SYSREG_INDEX(3, 14, 3, 2, 2):
-		return "CNTP_CVAL_EL0";
-	case SYSREG_INDEX(3, 14, 5, 2, 2):
-		return "CNTP_CVAL_EL02";
-	case SYSREG_INDEX(3, 14, 3, 2, 0):
-		return "CNTP_TVAL_EL0";
-	case SYSREG_INDEX(3, 14, 5, 2, 0):
-		return "CNTP_TVAL_EL02";
-	case SYSREG_INDEX(3, 14, 3, 0, 1):
-		return "CNTPCT_EL0";
-	case SYSREG_INDEX(3, 14, 7, 2, 1):
-		return "CNTPS_CTL_EL1";
-	case SYSREG_INDEX(3, 14, 7, 2, 2):
-		return "CNTPS_CVAL_EL1";
-	case SYSREG_INDEX(3, 14, 7, 2, 0):
-		return "CNTPS_TVAL_EL1";
-	case SYSREG_INDEX(3, 14, 3, 3, 1):
-		return "CNTV_CTL_EL0";
-	case SYSREG_INDEX(3, 14, 5, 3, 1):
-		return "CNTV_CTL_EL02";
-	case SYSREG_INDEX(3, 14, 3, 3, 2):
-		return "CNTV_CVAL_EL0";
-	case SYSREG_INDEX(3, 14, 5, 3, 2):
-		return "CNTV_CVAL_EL02";
-	case SYSREG_INDEX(3, 14, 3, 3, 0):
-		return "CNTV_TVAL_EL0";
-	case SYSREG_INDEX(3, 14, 5, 3, 0):
-		return "CNTV_TVAL_EL02";
-	case SYSREG_INDEX(3, 14, 3, 0, 2):
-		return "CNTVCT_EL0";
-	case SYSREG_INDEX(3, 14, 4, 0, 3):
-		return "CNTVOFF_EL2";
-	case SYSREG_INDEX(3, 13, 0, 0, 1):
-		return "CONTEXTIDR_EL1";
-	case SYSREG_INDEX(3, 13, 5, 0, 1):
-		return "CONTEXTIDR_EL12";
-	case SYSREG_INDEX(3, 13, 4, 0, 1):
-		return "CONTEXTIDR_EL2";
-	case SYSREG_INDEX(3, 1, 5, 0, 2):
-		return "CPACR_EL12";
-	case SYSREG_INDEX(3, 3, 4, 0, 0):
-		return "DACR32_EL2";
-	case SYSREG_INDEX(3, 5, 5, 2, 0):
-		return "ESR_EL12";
-	case SYSREG_INDEX(3, 6, 0, 0, 0):
-		return "FAR_EL1";
-	case SYSREG_INDEX(3, 6, 5, 0, 0):
-		return "FAR_EL12";
-	case SYSREG_INDEX(3, 6, 4, 0, 0):
-		return "FAR_EL2";
-	case SYSREG_INDEX(3, 6, 6, 0, 0):
-		return "FAR_EL3";
-	case SYSREG_INDEX(3, 5, 4, 3, 0):
-		return "FPEXC32_EL2";
-	case SYSREG_INDEX(3, 6, 4, 0, 4):
-		return "HPFAR_EL2";
-	case SYSREG_INDEX(3, 1, 4, 1, 3):
-		return "HSTR_EL2";
-	case SYSREG_INDEX(3, 0, 0, 5, 4):
-		return "ID_AA64AFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 5, 5):
-		return "ID_AA64AFR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 5, 1):
-		return "ID_AA64DFR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 4, 1):
-		return "ID_AA64PFR1_EL1";
-	case SYSREG_INDEX(3, 12, 0, 1, 0):
-		return "ISR_EL1";
-	case SYSREG_INDEX(3, 10, 0, 4, 1):
-		return "LOREA_EL1";
-	case SYSREG_INDEX(3, 10, 0, 4, 0):
-		return "LORSA_EL1";
-	case SYSREG_INDEX(3, 10, 0, 2, 0):
-		return "MAIR_EL1";
-	case SYSREG_INDEX(3, 10, 5, 2, 0):
-		return "MAIR_EL12";
-	case SYSREG_INDEX(3, 10, 4, 2, 0):
-		return "MAIR_EL2";
-	case SYSREG_INDEX(3, 10, 6, 2, 0):
-		return "MAIR_EL3";
-	case SYSREG_INDEX(3, 1, 4, 1, 1):
-		return "MDCR_EL2";
-	case SYSREG_INDEX(3, 0, 0, 3, 0):
-		return "MVFR0_EL1";
-	case SYSREG_INDEX(3, 0, 0, 3, 1):
-		return "MVFR1_EL1";
-	case SYSREG_INDEX(3, 0, 0, 3, 2):
-		return "MVFR2_EL1";
-	case SYSREG_INDEX(3, 12, 6, 0, 2):
-		return "RMR_EL3";
-	case SYSREG_INDEX(3, 1, 6, 1, 0):
-		return "SCR_EL3";
-	case SYSREG_INDEX(3, 1, 5, 0, 0):
-		return "SCTLR_EL12";
-	case SYSREG_INDEX(3, 1, 4, 0, 0):
-		return "SCTLR_EL2";
-	case SYSREG_INDEX(3, 1, 6, 1, 1):
-		return "SDER32_EL3";
-	case SYSREG_INDEX(3, 2, 5, 0, 2):
-		return "TCR_EL12";
-	case SYSREG_INDEX(3, 13, 3, 0, 2):
-		return "TPIDR_EL0";
-	case SYSREG_INDEX(3, 13, 0, 0, 4):
-		return "TPIDR_EL1";
-	case SYSREG_INDEX(3, 13, 4, 0, 2):
-		return "TPIDR_EL2";
-	case SYSREG_INDEX(3, 13, 6, 0, 2):
-		return "TPIDR_EL3";
-	case SYSREG_INDEX(3, 13, 3, 0, 3):
-		return "TPIDRRO_EL0";
-	case SYSREG_INDEX(3, 2, 5, 0, 0):
-		return "TTBR0_EL12";
-	case SYSREG_INDEX(3, 2, 5, 0, 1):
-		return "TTBR1_EL12";
-	case SYSREG_INDEX(3, 12, 0, 0, 0):
-		return "VBAR_EL1";
-	case SYSREG_INDEX(3, 12, 5, 0, 0):
-		return "VBAR_EL12";
-	case SYSREG_INDEX(3, 12, 4, 0, 0):
-		return "VBAR_EL2";
-	case SYSREG_INDEX(3, 12, 6, 0, 0):
-		return "VBAR_EL3";
-	case SYSREG_INDEX(3, 0, 4, 0, 5):
-		return "VMPIDR_EL2";
-	case SYSREG_INDEX(3, 0, 4, 0, 0):
-		return "VPIDR_EL2";
-	default:
-		return "unknown";
-	}
-}
-
-static void decode_iss_msr(struct bitfield *iss)
-{
-	describe_res0(22, 24);
-	u64 op0 = bitfield_describe("Op0", NULL, 20, 21, NULL);
-	u64 op2 = bitfield_describe("Op2", NULL, 17, 19, NULL);
-	u64 op1 = bitfield_describe("Op1", NULL, 14, 16, NULL);
-	u64 crn = bitfield_describe("CRn", NULL, 10, 13, NULL);
-	u64 rt = bitfield_describe(
-		"Rt",
-		"General-purpose register number of the trapped instruction", 5,
-		9, NULL);
-	u64 crm = bitfield_describe("CRm", NULL, 1, 4, NULL);
-	u64 dir = bitfield_describe("Dir",
-				    "Direction of the trapped instruction", 0,
-				    0, describe_msr_direction);
-	if (dir) {
-		printf("# MRS x%lu, %s\n", rt,
-		       sysreg_name(op0, op1, op2, crn, crm));
-	} else {
-		printf("# MSR %s, x%lu\n", sysreg_name(op0, op1, op2, crn, crm),
-		       rt);
+	unsigned int enc = SYS_REG(op0 & 0x3, op1 & 0x7, crn & 0xf, crm & 0xf,
+				   op2 & 0x7);
+#ifdef ESR_SMALL
+	size_t lo = 0, hi = ARRAY_SIZE(sysreg_encs);
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (sysreg_encs[mid] < enc) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
 	}
-}
+	if (lo < ARRAY_SIZE(sysreg_encs) && sysreg_encs[lo] == enc) {
+		return sysreg_pool + sysreg_enc_names[lo];
+	}
+	return sysreg_pool;
+#else
+	return sysreg_pool + sysreg_names[sysreg_index[enc]];
+#endif
+}
+
+static void decode_sysreg(struct esr_result *res)
+{
+	u64 esr = res->esr;
+
+	res->sysreg = esr_sysreg_name(get_bits(esr, 20, 21),
+				      get_bits(esr, 14, 16),
+				      get_bits(esr, 17, 19),
+				      get_bits(esr, 10, 13),
+				      get_bits(esr, 1, 4));
+	res->sysreg_rt = get_bits(esr, 5, 9);
+	res->sysreg_dir = get_bits(esr, 0, 0);
+}
+
+struct ec_class {
+	/* In esr_strings, as in Linux's ESR_ELx_EC_*: none if unallocated. */
+	unsigned short name;
+	unsigned short desc;
+	/* ISS bits that are RES0 for every ESR of the class. */
+	u32 iss_res0;
+	/*
+	 * ISS bits telling faults of the class apart, see esr_summary_mask().
+	 * Register numbers and the SVC/HVC/SMC immediate are left out.
+	 */
+	u32 key;
+	unsigned int nr_fields;
+	const struct field_layout *fields;
+	/* What the fields do not say, if anything. */
+	decode_fn decode;
+};
 
-static void decode_iss_tstart(struct bitfield *iss)
+#define CLASS(id) .name = STR(ec_##id), .desc = STR(ec_##id##_desc)
+
+/* Classes the architecture has not allocated. */
+#define UNALLOCATED                                                     \
+	{                                                               \
+		.desc = STR(bad_ec),                                    \
+		.fields = default_fields,                               \
+		.nr_fields = ARRAY_SIZE(default_fields),                \
+	}
+
+/* Exception classes, indexed by EC. */
+static const struct ec_class ec_classes[64] = {
+	[0b000000] = {
+		CLASS(UNKNOWN),
+		.fields = res0_fields,
+		.nr_fields = ARRAY_SIZE(res0_fields),
+		.iss_res0 = GENMASK(24, 0),
+	},
+	[0b000001] = {
+		CLASS(WFx),
+		.fields = wf_fields,
+		.nr_fields = ARRAY_SIZE(wf_fields),
+		.iss_res0 = GENMASK(19, 10) | GENMASK(4, 3),
+		.key = GENMASK(1, 0),
+	},
+	[0b000010] = UNALLOCATED,
+	[0b000011] = {
+		CLASS(CP15_32),
+		.fields = mcr_fields,
+		.nr_fields = ARRAY_SIZE(mcr_fields),
+		.iss_res0 = 0,
+		.key = GENMASK(19, 10) | GENMASK(4, 0),
+	},
+	[0b000100] = {
+		CLASS(CP15_64),
+		.fields = mcrr_fields,
+		.nr_fields = ARRAY_SIZE(mcrr_fields),
+		.iss_res0 = BIT(15),
+		.key = GENMASK(19, 16) | GENMASK(4, 0),
+	},
+	[0b000101] = {
+		CLASS(CP14_MR),
+		.fields = mcr_fields,
+		.nr_fields = ARRAY_SIZE(mcr_fields),
+		.iss_res0 = 0,
+		.key = GENMASK(19, 10) | GENMASK(4, 0),
+	},
+	[0b000110] = {
+		CLASS(CP14_LS),
+		.fields = ldc_fields,
+		.nr_fields = ARRAY_SIZE(ldc_fields),
+		.iss_res0 = GENMASK(11, 10),
+	},
+	[0b000111] = {
+		CLASS(FP_ASIMD),
+		.fields = sve_fields,
+		.nr_fields = ARRAY_SIZE(sve_fields),
+		.iss_res0 = GENMASK(19, 0),
+	},
+	[0b001000] = UNALLOCATED,
+	[0b001001] = UNALLOCATED,
+	[0b001010] = {
+		CLASS(LS64),
+		.fields = ld64b_fields,
+		.nr_fields = ARRAY_SIZE(ld64b_fields),
+		.iss_res0 = 0,
+	},
+	[0b001011] = UNALLOCATED,
+	[0b001100] = {
+		CLASS(CP14_64),
+		.fields = mcrr_fields,
+		.nr_fields = ARRAY_SIZE(mcrr_fields),
+		.iss_res0 = BIT(15),
+		.key = GENMASK(19, 16) | GENMASK(4, 0),
+	},
+	[0b001101] = {
+		CLASS(BTI),
+		.fields = bti_fields,
+		.nr_fields = ARRAY_SIZE(bti_fields),
+		.iss_res0 = GENMASK(24, 2),
+		.key = GENMASK(1, 0),
+	},
+	[0b001110] = {
+		CLASS(ILL),
+		.fields = res0_fields,
+		.nr_fields = ARRAY_SIZE(res0_fields),
+		.iss_res0 = GENMASK(24, 0),
+	},
+	[0b001111] = UNALLOCATED,
+	[0b010000] = UNALLOCATED,
+	[0b010001] = {
+		CLASS(SVC32),
+		.fields = hvc_fields,
+		.nr_fields = ARRAY_SIZE(hvc_fields),
+		.iss_res0 = GENMASK(24, 16),
+	},
+	[0b010010] = UNALLOCATED,
+	[0b010011] = UNALLOCATED,
+	[0b010100] = UNALLOCATED,
+	[0b010101] = {
+		CLASS(SVC64),
+		.fields = hvc_fields,
+		.nr_fields = ARRAY_SIZE(hvc_fields),
+		.iss_res0 = GENMASK(24, 16),
+	},
+	[0b010110] = {
+		CLASS(HVC64),
+		.fields = hvc_fields,
+		.nr_fields = ARRAY_SIZE(hvc_fields),
+		.iss_res0 = GENMASK(24, 16),
+	},
+	[0b010111] = {
+		CLASS(SMC64),
+		.fields = hvc_fields,
+		.nr_fields = ARRAY_SIZE(hvc_fields),
+		.iss_res0 = GENMASK(24, 16),
+	},
+	[0b011000] = {
+		CLASS(SYS64),
+		.fields = msr_fields,
+		.nr_fields = ARRAY_SIZE(msr_fields),
+		.decode = decode_sysreg,
+		.iss_res0 = GENMASK(24, 22),
+		.key = GENMASK(21, 10) | GENMASK(4, 0),
+	},
+	[0b011001] = {
+		CLASS(SVE),
+		.fields = res0_fields,
+		.nr_fields = ARRAY_SIZE(res0_fields),
+		.iss_res0 = GENMASK(24, 0),
+	},
+	[0b011010] = UNALLOCATED,
+	[0b011011] = {
+		CLASS(TSTART),
+		.fields = tstart_fields,
+		.nr_fields = ARRAY_SIZE(tstart_fields),
+		.iss_res0 = GENMASK(24, 10) | GENMASK(4, 0),
+	},
+	[0b011100] = {
+		CLASS(FPAC),
+		.fields = pauth_fields,
+		.nr_fields = ARRAY_SIZE(pauth_fields),
+		.iss_res0 = GENMASK(24, 2),
+		.key = GENMASK(1, 0),
+	},
+	[0b011101] = {
+		CLASS(SME),
+		.fields = sme_fields,
+		.nr_fields = ARRAY_SIZE(sme_fields),
+		.iss_res0 = GENMASK(24, 3),
+		.key = GENMASK(2, 0),
+	},
+	[0b011110] = {
+		CLASS(GPC),
+		.fields = gpc_fields,
+		.nr_fields = ARRAY_SIZE(gpc_fields),
+		.iss_res0 = GENMASK(24, 22) | GENMASK(12, 9),
+		.key = GENMASK(21, 13) | GENMASK(8, 0),
+	},
+	[0b011111] = UNALLOCATED,
+	[0b100000] = {
+		CLASS(IABT_LOW),
+		.fields = instruction_abort_fields,
+		.nr_fields = ARRAY_SIZE(instruction_abort_fields),
+		.iss_res0 = GENMASK(24, 13) | BIT(8) | BIT(6),
+		.key = GENMASK(12, 11) | BIT(9) | GENMASK(7, 0),
+	},
+	[0b100001] = {
+		CLASS(IABT_CUR),
+		.fields = instruction_abort_fields,
+		.nr_fields = ARRAY_SIZE(instruction_abort_fields),
+		.iss_res0 = GENMASK(24, 13) | BIT(8) | BIT(6),
+		.key = GENMASK(12, 11) | BIT(9) | GENMASK(7, 0),
+	},
+	[0b100010] = {
+		CLASS(PC_ALIGN),
+		.fields = res0_fields,
+		.nr_fields = ARRAY_SIZE(res0_fields),
+		.iss_res0 = GENMASK(24, 0),
+	},
+	[0b100011] = UNALLOCATED,
+	[0b100100] = {
+		CLASS(DABT_LOW),
+		.fields = data_abort_fields,
+		.nr_fields = ARRAY_SIZE(data_abort_fields),
+		.iss_res0 = 0,
+		.key = GENMASK(13, 11) | GENMASK(9, 0),
+	},
+	[0b100101] = {
+		CLASS(DABT_CUR),
+		.fields = data_abort_fields,
+		.nr_fields = ARRAY_SIZE(data_abort_fields),
+		.iss_res0 = 0,
+		.key = GENMASK(13, 11) | GENMASK(9, 0),
+	},
+	[0b100110] = {
+		CLASS(SP_ALIGN),
+		.fields = res0_fields,
+		.nr_fields = ARRAY_SIZE(res0_fields),
+		.iss_res0 = GENMASK(24, 0),
+	},
+	[0b100111] = UNALLOCATED,
+	[0b101000] = {
+		CLASS(FP_EXC32),
+		.fields = fp_fields,
+		.nr_fields = ARRAY_SIZE(fp_fields),
+		.iss_res0 = BIT(24) | GENMASK(22, 11) | GENMASK(6, 5),
+		.key = BIT(23) | BIT(7) | GENMASK(4, 0),
+	},
+	[0b101001] = UNALLOCATED,
+	[0b101010] = UNALLOCATED,
+	[0b101011] = UNALLOCATED,
+	[0b101100] = {
+		CLASS(FP_EXC64),
+		.fields = fp_fields,
+		.nr_fields = ARRAY_SIZE(fp_fields),
+		.iss_res0 = BIT(24) | GENMASK(22, 11) | GENMASK(6, 5),
+		.key = BIT(23) | BIT(7) | GENMASK(4, 0),
+	},
+	[0b101101] = UNALLOCATED,
+	[0b101110] = UNALLOCATED,
+	[0b101111] = {
+		CLASS(SERROR),
+		.fields = serror_fields,
+		.nr_fields = ARRAY_SIZE(serror_fields),
+		.iss_res0 = 0,
+		.key = BIT(24) | GENMASK(13, 9) | GENMASK(5, 0),
+	},
+	[0b110000] = {
+		CLASS(BREAKPT_LOW),
+		.fields = breakpoint_vector_catch_fields,
+		.nr_fields = ARRAY_SIZE(breakpoint_vector_catch_fields),
+		.iss_res0 = GENMASK(24, 6),
+		.key = GENMASK(5, 0),
+	},
+	[0b110001] = {
+		CLASS(BREAKPT_CUR),
+		.fields = breakpoint_vector_catch_fields,
+		.nr_fields = ARRAY_SIZE(breakpoint_vector_catch_fields),
+		.iss_res0 = GENMASK(24, 6),
+		.key = GENMASK(5, 0),
+	},
+	[0b110010] = {
+		CLASS(SOFTSTP_LOW),
+		.fields = software_step_fields,
+		.nr_fields = ARRAY_SIZE(software_step_fields),
+		.iss_res0 = GENMASK(23, 7),
+		.key = BIT(24) | GENMASK(6, 0),
+	},
+	[0b110011] = {
+		CLASS(SOFTSTP_CUR),
+		.fields = software_step_fields,
+		.nr_fields = ARRAY_SIZE(software_step_fields),
+		.iss_res0 = GENMASK(23, 7),
+		.key = BIT(24) | GENMASK(6, 0),
+	},
+	[0b110100] = {
+		CLASS(WATCHPT_LOW),
+		.fields = watchpoint_fields,
+		.nr_fields = ARRAY_SIZE(watchpoint_fields),
+		.iss_res0 = BIT(24) | BIT(14) | GENMASK(12, 11) | BIT(9) |
+			    BIT(7),
+		.key = BIT(8) | GENMASK(6, 0),
+	},
+	[0b110101] = {
+		CLASS(WATCHPT_CUR),
+		.fields = watchpoint_fields,
+		.nr_fields = ARRAY_SIZE(watchpoint_fields),
+		.iss_res0 = BIT(24) | BIT(14) | GENMASK(12, 11) | BIT(9) |
+			    BIT(7),
+		.key = BIT(8) | GENMASK(6, 0),
+	},
+	[0b110110] = UNALLOCATED,
+	[0b110111] = UNALLOCATED,
+	[0b111000] = {
+		CLASS(BKPT32),
+		.fields = breakpoint_fields,
+		.nr_fields = ARRAY_SIZE(breakpoint_fields),
+		.iss_res0 = GENMASK(24, 16),
+		.key = GENMASK(15, 0),
+	},
+	[0b111001] = UNALLOCATED,
+	[0b111010] = UNALLOCATED,
+	[0b111011] = UNALLOCATED,
+	[0b111100] = {
+		CLASS(BRK64),
+		.fields = breakpoint_fields,
+		.nr_fields = ARRAY_SIZE(breakpoint_fields),
+		.iss_res0 = GENMASK(24, 16),
+		.key = GENMASK(15, 0),
+	},
+	[0b111101] = UNALLOCATED,
+	[0b111110] = UNALLOCATED,
+	[0b111111] = UNALLOCATED,
+};
+
+static void decode_fields(struct esr_result *res, const struct field_layout *f,
+			  size_t n)
 {
-	describe_res0(10, 24);
-	bitfield_describe(
-		"Rd",
-		"General-purpose register number used for the destination", 5,
-		9, NULL);
-	describe_res0(0, 4);
+	u64 esr = res->esr;
+
+	for (; n--; f++) {
+		struct bitfield *field;
+
+		if ((esr & f->if_mask) != f->if_value ||
+		    (f->unless_mask &&
+		     (esr & f->unless_mask) == f->unless_value)) {
+			continue;
+		}
+		if (res->nr_fields == ESR_MAX_FIELDS) {
+			break;
+		}
+
+		field = &res->fields[res->nr_fields++];
+		field->name = pool_str(f->name);
+		field->long_name = pool_str(f->long_name);
+		field->start = f->start;
+		field->width = f->end - f->start + 1;
+		field->value = get_bits(esr, f->start, f->end);
+		field->desc = NULL;
+		if (f->describe) {
+			f->describe(field);
+		}
+		if ((f->flags & ESR_FIELD_RES0) && field->value) {
+			res->nr_res0_errors++;
+		}
+	}
 }
 
-static void decode_iss_pauth(struct bitfield *iss)
+static const struct ec_class *decode_ec(struct esr_result *res)
 {
-	describe_res0(2, 24);
-	bitfield_describe("IorD", "Instruction key or Data key", 1, 1,
-			  describe_iord);
-	bitfield_describe("AorB", "A key or B key", 0, 0, describe_aorb);
+	const struct ec_class *class;
+	struct bitfield ec;
+
+	bitfield_new(res->esr, "EC", "Exception Class", 26, 31, NULL, &ec);
+	class = &ec_classes[ec.value];
+	ec.desc = pool_str(class->desc);
+
+	res->ec = ec.value;
+	res->ec_desc = ec.desc;
+	field_append(res, &ec);
+
+	return class;
 }
 
-static void decode_iss_sme(struct bitfield *iss)
+const char *esr_ec_name(u64 ec)
 {
-	describe_res0(3, 24);
-	bitfield_describe("SMTC", "SME Trap Code", 0, 2, describe_smtc);
+	return pool_str(ec_classes[ec & 0x3f].name);
 }
 
-static void decode_iss_gpc(struct bitfield *iss)
+const char *esr_ec_desc(u64 ec)
 {
-	describe_res0(22, 24);
-	bitfield_describe("S2PTW", "Stage-2 translation table walk", 21, 21,
-			  describe_s2ptw);
-	u64 ind = bitfield_describe("InD", "Instruction or Data access", 20, 20,
-				    describe_ind);
-	bitfield_describe("GPCSC", "Granule Protection Check Status Code", 14,
-			  19, describe_gpcsc);
-	bitfield_describe("VNCR", NULL, 13, 13, describe_vncr);
-	describe_res0(11, 12);
-	describe_res0(9, 10);
-	bitfield_describe("CM", "Cache maintenance", 8, 8, describe_cm);
-	bitfield_describe("S1PTW", "Stage-1 translation table walk", 7, 7,
-			  describe_s1ptw);
-	if (ind == 1) {
-		describe_res0(6, 6);
-	} else {
-		bitfield_describe("WnR", "Write or Read", 6, 6,
-				  describe_gpc_wnr);
-	}
-	bitfield_describe("xFSC", "Instruction or Data Fault Status Code", 0, 5,
-			  describe_xfsc);
+	return pool_str(ec_classes[ec & 0x3f].desc);
 }
 
-static void decode_iss_default(struct bitfield *iss)
+size_t esr_ec_nr_fields(u64 ec)
 {
-	iss->desc = "[ERROR]: bad iss";
-	bitfield_print(iss);
+	return ec_classes[ec & 0x3f].nr_fields;
 }
 
-static void decode_iss_instruction_abort(struct bitfield *iss)
+void esr_ec_field(u64 ec, size_t i, struct esr_field *field)
 {
-	struct bitfield fsc;
+	const struct field_layout *f = &ec_classes[ec & 0x3f].fields[i];
 
-	describe_res0(13, 24);
-	bitfield_new(iss->value, "IFSC", "Instruction Fault Status Code", 0, 5,
-		     describe_fsc, &fsc);
-	if (fsc.value == 0b010000) {
-		bitfield_describe("SET", "Synchronous Error Type", 11, 12,
-				  describe_set);
-	} else {
-		describe_res0(11, 12);
-	}
-	bitfield_describe("FnV", "FAR not Valid", 10, 10, describe_fnv);
-	bitfield_describe("EA", "External About type", 9, 9, NULL);
-	describe_res0(8, 8);
-	bitfield_describe("S1PTW", "Stage-1 translation table walk", 7, 7,
-			  describe_s1ptw);
-	describe_res0(6, 6);
-	bitfield_print(&fsc);
-}
-
-static void decode_iss_fp(struct bitfield *iss)
-{
-	describe_res0(24, 24);
-	bitfield_describe("TFV", "Trapped Fault Valid", 23, 23, describe_tfv);
-	describe_res0(11, 22);
-	bitfield_describe("VECITR", "RES1 or UNKNOWN", 8, 10, NULL);
-	bitfield_describe("IDF", "Input Denomal", 7, 7, describe_idf);
-	describe_res0(5, 6);
-	bitfield_describe("IXF", "Inexact", 4, 4, describe_ixf);
-	bitfield_describe("UFF", "Underflow", 3, 3, describe_uff);
-	bitfield_describe("OFF", "Overflow", 2, 2, describe_off);
-	bitfield_describe("DZF", "Divide by Zero", 1, 1, describe_dzf);
-	bitfield_describe("IOF", "Invalid Operation", 0, 0, describe_iof);
-}
-
-static void decode_iss_serror(struct bitfield *iss)
-{
-	struct bitfield dfsc;
-	u64 ids = bitfield_describe("IDS", "Implementation Defined Syndrome",
-				    24, 24, describe_ids);
-	if (ids == 1) {
-		bitfield_describe("IMPDEF", "Implementation defined", 0, 23,
-				  NULL);
-		return;
-	}
-
-	describe_res0(14, 23);
-	bitfield_new(iss->value, "DFSC", "Data Fault Status Code", 0, 5,
-		     describe_serror_dfsc, &dfsc);
-	if (dfsc.value == 0b010001) {
-		bitfield_describe("IESB",
-				  "Implicit Error Synchronisation event", 13,
-				  13, describe_iesb);
-	} else {
-		describe_res0(13, 13);
-	}
-	bitfield_describe("AET", "Asynchronous Error Type", 10, 12,
-			  describe_aet);
-	if (dfsc.value == 0b010001) {
-		bitfield_describe("EA", "External Abort type", 9, 9, NULL);
-	} else {
-		describe_res0(9, 9);
-	}
-	describe_res0(6, 8);
-	bitfield_print(&dfsc);
+	field->name = pool_str(f->name);
+	field->long_name = pool_str(f->long_name);
+	field->start = f->start;
+	field->end = f->end;
+	field->flags = f->flags;
+	field->if_mask = f->if_mask;
+	field->if_value = f->if_value;
+	field->unless_mask = f->unless_mask;
+	field->unless_value = f->unless_value;
+	field->describe = f->describe;
 }
 
-static void decode_iss_breakpoint_vector_catch(struct bitfield *iss)
+u64 esr_iss_res0_mask(u64 ec)
 {
-	describe_res0(6, 24);
-	bitfield_describe("IFSC", "Instruction Fault Status Code", 0, 5,
-			  describe_debug_fsc);
+	return ec_classes[ec & 0x3f].iss_res0;
 }
 
-static void decode_iss_software_step(struct bitfield *iss)
+u64 esr_summary_mask(u64 esr)
 {
-	u64 isv = bitfield_describe("ISV", "Instruction Syndrome Valid", 24, 24,
-				    describe_isv);
-	describe_res0(7, 23);
-	if (isv == 1) {
-		bitfield_describe("EX", "Exclusive operation", 6, 6,
-				  describe_ex);
-	} else {
-		describe_res0(6, 6);
+	u64 ec = ESR_EC(esr);
+
+	/* The rest of an IMPLEMENTATION DEFINED SError syndrome is opaque. */
+	if (ec == 0b101111 && (esr & BIT(24))) {
+		return GENMASK(31, 26) | BIT(24);
 	}
-	bitfield_describe("IFSC", "Instruction Fault Status Code", 0, 5,
-			  describe_debug_fsc);
+
+	return GENMASK(31, 26) | ec_classes[ec].key;
 }
 
-static void decode_iss_watchpoint(struct bitfield *iss)
+static u64 hash_u64(u64 h, u64 val)
 {
-	describe_res0(24, 24);
-	bitfield_describe("WPT", "Watchpoint number", 18, 23, NULL);
-	bitfield_describe("WPTV", "Watchpoint number Valid", 17, 17,
-			  describe_wptv);
-	bitfield_describe("WPF", "Watchpoint might be false-positive", 16, 16,
-			  describe_wpf);
-	bitfield_describe("FnP", "FAR not Precise", 15, 15, describe_fnp);
-	describe_res0(14, 14);
-	bitfield_describe("VNCR", NULL, 13, 13, describe_wp_vncr);
-	describe_res0(11, 12);
-	bitfield_describe("FnV", "FAR not Valid", 10, 10, describe_wp_fnv);
-	describe_res0(9, 9);
-	bitfield_describe("CM", "Cache Maintenance", 8, 8, describe_wp_cm);
-	describe_res0(7, 7);
-	bitfield_describe("WnR", "Write not Read", 6, 6, describe_wp_wnr);
-	bitfield_describe("DFSC", "Data Fault Status Code", 0, 5,
-			  describe_debug_fsc);
+	for (int i = 0; i < 8; i++, val >>= 8) {
+		h = (h ^ (val & 0xff)) * 0x100000001b3UL;
+	}
+	return h;
 }
 
-static void decode_iss_breakpoint(struct bitfield *iss)
+static u64 hash_str(u64 h, const char *s)
 {
-	describe_res0(16, 24);
-	bitfield_describe("Comment",
-			  "Instruction comment field or immediate field", 0, 15,
-			  NULL);
+	if (!s) {
+		return hash_u64(h, ~0UL);
+	}
+	do {
+		h = (h ^ (unsigned char)*s) * 0x100000001b3UL;
+	} while (*s++);
+	return h;
 }
 
-describe_fn decode_ec()
+u64 esr_tables_hash(void)
 {
-	struct bitfield ec;
-	describe_fn iss_decoder = decode_iss_default;
+	u64 h = 0xcbf29ce484222325UL;
 
-	bitfield_new(_esr, "EC", "Exception Class", 26, 31, NULL, &ec);
+	for (u64 ec = 0; ec < 64; ec++) {
+		const struct ec_class *class = &ec_classes[ec];
 
-	switch (ec.value) {
-	case 0b000000:
-		ec.desc = "Unknown reason";
-		iss_decoder = decode_iss_res0;
-		break;
-	case 0b000001:
-		ec.desc = "Wrapped WF* instruction execution";
-		iss_decoder = decode_iss_wf;
-		break;
-	case 0b000011:
-		ec.desc = "Trapped MCR or MRC access with coproc = 0b1111";
-		iss_decoder = decode_iss_mcr;
-		break;
-	case 0b000100:
-		ec.desc = "Trapped MCRR or MRRC access with coproc = 0b1111";
-		iss_decoder = decode_iss_mcrr;
-		break;
-	case 0b000101:
-		ec.desc = "Trapped MCR or MRC access with coproc = 0b1110";
-		iss_decoder = decode_iss_mcr;
-		break;
-	case 0b000110:
-		ec.desc = "Trapped LDC or STC access";
-		iss_decoder = decode_iss_ldc;
-		break;
-	case 0b000111:
-		ec.desc =
-			"Trapped access to SVE, Advanced SIMD or floating point";
-		iss_decoder = decode_iss_sve;
-		break;
-	case 0b001010:
-		ec.desc =
-			"Trapped execution of an LD64B, ST64B, ST64BV, or ST64BV0 instruction";
-		iss_decoder = decode_iss_ld64b;
-		break;
-	case 0b001100:
-		ec.desc = "Trapped MRRC access with coproc == 0b1110";
-		iss_decoder = decode_iss_mcrr;
-		break;
-	case 0b001101:
-		ec.desc = "Branch Target Exception";
-		iss_decoder = decode_iss_bti;
-		break;
-	case 0b001110:
-		ec.desc = "Illegal Execution state";
-		iss_decoder = decode_iss_res0;
-		break;
-	case 0b010001:
-		ec.desc = "SVC instruction execution in AArch32 state";
-		iss_decoder = decode_iss_hvc;
-		break;
-	case 0b010101:
-		ec.desc = "SVC instruction execution in AArch64 state";
-		iss_decoder = decode_iss_hvc;
-		break;
-	case 0b010110:
-		ec.desc = "HVC instruction execution in AArch64 state";
-		iss_decoder = decode_iss_hvc;
-		break;
-	case 0b010111:
-		ec.desc = "SMC instruction execution in AArch64 state";
-		iss_decoder = decode_iss_hvc;
-		break;
-	case 0b011000:
-		ec.desc =
-			"Trapped MSR, MRS or System instruction execution in AArch64 state";
-		iss_decoder = decode_iss_msr;
-		break;
-	case 0b011001:
-		ec.desc =
-			"Access to SVE functionality trapped as a result of CPACR_EL1.ZEN, CPTR_EL2.ZEN, CPTR_EL2.TZ, or CPTR_EL3.EZ";
-		iss_decoder = decode_iss_res0;
-		break;
-	case 0b011011:
-		ec.desc =
-			"Exception from an access to a TSTART instruction at EL0 when SCTLR_EL1.TME0 == 0, EL0 when SCTLR_EL2.TME0 == 0, at EL1 when SCTLR_EL1.TME == 0, at EL2 when SCTLR_EL2.TME == 0 or at EL3 when SCTLR_EL3.TME == 0";
-		iss_decoder = decode_iss_tstart;
-		break;
-	case 0b011100:
-		ec.desc =
-			"Exception from a Pointer Authentication instruction authentication failure";
-		iss_decoder = decode_iss_pauth;
-		break;
-	case 0b011101:
-		ec.desc =
-			"Access to SME functionality trapped as a result of CPACR_EL1.SMEN, CPTR_EL2.SMEN, CPTR_EL2.TSM, CPTR_EL3.ESM, or an attempted execution of an instruction that is illegal because of the value of PSTATE.SM or PSTATE.ZA";
-		iss_decoder = decode_iss_sme;
-		break;
-	case 0b011110:
-		ec.desc = "Exception from a Granule Protection Check";
-		iss_decoder = decode_iss_gpc;
-		break;
-	case 0b100000:
-		ec.desc = "Instruction Abort from a lower Exception level";
-		iss_decoder = decode_iss_instruction_abort;
-		break;
-	case 0b100001:
-		ec.desc =
-			"Instruction Abort taken without a change in Exception level";
-		iss_decoder = decode_iss_instruction_abort;
-		break;
-	case 0b100010:
-		ec.desc = "PC alignment fault exception";
-		iss_decoder = decode_iss_res0;
-		break;
-	case 0b100100:
-		ec.desc = "Data Abort from a lower Exception level";
-		iss_decoder = decode_iss_data_abort;
-	case 0b100101:
-		ec.desc =
-			"Data Abort taken without a change in Exception level";
-		iss_decoder = decode_iss_data_abort;
-		break;
-	case 0b100110:
-		ec.desc = "SP alignment fault exception";
-		iss_decoder = decode_iss_res0;
-		break;
-	case 0b101000:
-		ec.desc =
-			"Trapped floating-ppint exception taken from AArch32 state";
-		iss_decoder = decode_iss_fp;
-		break;
-	case 0b101100:
-		ec.desc =
-			"Trapped floating-ppint exception taken from AArch64 state";
-		iss_decoder = decode_iss_fp;
-		break;
-	case 0b101111:
-		ec.desc = "SError interrupt";
-		iss_decoder = decode_iss_serror;
-		break;
-	case 0b110000:
-		ec.desc = "Breakpoint execution from a lower Exception level";
-		iss_decoder = decode_iss_breakpoint_vector_catch;
-		break;
-	case 0b110001:
-		ec.desc =
-			"Breakpoint exception taken without a change in Exception level";
-		iss_decoder = decode_iss_breakpoint_vector_catch;
-		break;
-	case 0b110010:
-		ec.desc =
-			"Software Step exception from a lower Exception level";
-		iss_decoder = decode_iss_software_step;
-		break;
-	case 0b110011:
-		ec.desc =
-			"Software Step exception taken without a change in Exception level";
-		iss_decoder = decode_iss_software_step;
-		break;
-	case 0b110100:
-		ec.desc = "Watchpoint exception from a lower Exception level";
-		iss_decoder = decode_iss_watchpoint;
-		break;
-	case 0b110101:
-		ec.desc =
-			"Watchpoint exception taken without a change in Exception level";
-		iss_decoder = decode_iss_watchpoint;
-		break;
-	case 0b111000:
-		ec.desc = "BKPT instruction execution in AArch32 state";
-		iss_decoder = decode_iss_breakpoint;
-		break;
-	case 0b111100:
-		ec.desc = "BRK instruction execution in AArch64 state";
-		iss_decoder = decode_iss_breakpoint;
-		break;
-	default:
-		ec.desc = "[ERROR]: bad ec";
-		break;
-	}
+		h = hash_str(h, pool_str(class->name));
+		h = hash_str(h, pool_str(class->desc));
+		h = hash_u64(h, class->iss_res0);
+		h = hash_u64(h, class->key);
+		h = hash_u64(h, class->nr_fields);
 
-	bitfield_print(&ec);
+		for (size_t i = 0; i < class->nr_fields; i++) {
+			struct esr_field f;
 
-	return iss_decoder;
-}
+			esr_ec_field(ec, i, &f);
 
-static void decode(u64 esr)
-{
-	struct bitfield res0;
-	struct bitfield iss2;
-	struct bitfield iss;
+			h = hash_str(h, f.name);
+			h = hash_str(h, f.long_name);
+			h = hash_u64(h, f.start | f.end << 8 | f.flags << 16);
+			h = hash_u64(h, f.if_mask);
+			h = hash_u64(h, f.if_value);
+			h = hash_u64(h, f.unless_mask);
+			h = hash_u64(h, f.unless_value);
 
-	_esr = esr;
+			/* Enough values to cover every fault status code. */
+			for (u64 val = 0; f.describe && val < 64 &&
+					  val < 1UL << (f.end - f.start + 1);
+			     val++) {
+				struct bitfield field = {
+					.name = f.name,
+					.start = f.start,
+					.width = f.end - f.start + 1,
+					.value = val,
+				};
 
-	describe_res0(37, 63);
-	bitfield_describe("ISS2", "Instruction Specific Syndrome 2", 32, 36,
-			  NULL);
+				f.describe(&field);
+				h = hash_str(h, field.desc);
+			}
+		}
+	}
 
-	describe_fn iss_decoder = decode_ec();
+	for (u64 enc = 0; enc < 1 << 16; enc++) {
+		h = hash_u64(h, esr_sysreg_name(enc >> 14, (enc >> 11) & 0x7,
+						enc & 0x7, (enc >> 7) & 0xf,
+						(enc >> 3) & 0xf) -
+				       sysreg_pool);
+	}
+	for (size_t i = 0; i < sizeof(sysreg_pool); i++) {
+		h = (h ^ (unsigned char)sysreg_pool[i]) * 0x100000001b3UL;
+	}
 
-	bitfield_describe("IL", "Instruction Length", 25, 25, describe_il);
+	return h;
+}
 
-	bitfield_new(esr, "ISS", "Instruction Specific Syndrome", 0, 24,
-		     iss_decoder, &iss);
+u64 esr_signature(u64 esr)
+{
+	return esr & esr_summary_mask(esr);
 }
 
-int main(int argc, char *argv[])
+void esr_decode(u64 esr, struct esr_result *res)
 {
-	if (argc < 2) {
-		printf("bad input\n");
-		exit(1);
-	}
+	res->esr = esr;
+	res->nr_fields = 0;
+	res->nr_res0_errors = 0;
+	res->sysreg = NULL;
+	res->sysreg_rt = 0;
+	res->sysreg_dir = 0;
 
-	for (int i = 1; i < argc; i++) {
-		printf("ESR: %s\n", argv[i]);
-		u64 reg;
-		sscanf(argv[i], "%lx", &reg);
-		decode(reg);
-		printf("\n");
-	}
+	describe_res0(res, 37, 63);
+	res->iss2 = bitfield_describe(res, "ISS2",
+				      "Instruction Specific Syndrome 2", 32, 36,
+				      NULL);
 
-	return 0;
+	const struct ec_class *class = decode_ec(res);
+
+	res->il = bitfield_describe(res, "IL", "Instruction Length", 25, 25,
+				    describe_il);
+	res->iss = get_bits(esr, 0, 24);
+
+	decode_fields(res, class->fields, class->nr_fields);
+	if (class->decode) {
+		class->decode(res);
+	}
 }
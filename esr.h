@@ -0,0 +1,156 @@
+#ifndef ESR_H
+#define ESR_H
+
+#include <stddef.h>
+
+typedef unsigned long u64;
+typedef unsigned int u32;
+
+#define ESR_EC(esr) (((esr) >> 26) & 0x3f)
+
+/* Upper bound on the number of fields a single ESR is decoded into. */
+#define ESR_MAX_FIELDS 24
+
+struct bitfield {
+	const char *name;
+	const char *long_name;
+	size_t start;
+	size_t width;
+	u64 value;
+	const char *desc;
+};
+
+struct esr_result {
+	u64 esr;
+	u64 ec;
+	u64 il;
+	u64 iss;
+	u64 iss2;
+	const char *ec_desc;
+
+	/* Decoded fields, in print order. */
+	size_t nr_fields;
+	struct bitfield fields[ESR_MAX_FIELDS];
+
+	/* Number of RES0 fields holding a non-zero value. */
+	size_t nr_res0_errors;
+
+	/*
+	 * Trapped MSR/MRS accesses (EC == 0b011000) also report the accessed
+	 * system register, otherwise sysreg is NULL.
+	 */
+	const char *sysreg;
+	u64 sysreg_rt;
+	u64 sysreg_dir;
+};
+
+/*
+ * Decode @esr into @res. The result only references static data, so
+ * esr_decode() can be called concurrently from any number of threads.
+ */
+void esr_decode(u64 esr, struct esr_result *res);
+
+/* Where a field of an exception class is, see esr_ec_field(). */
+struct esr_field {
+	const char *name;
+	const char *long_name;
+	unsigned char start;
+	unsigned char end;
+	/* ESR_FIELD_* */
+	unsigned char flags;
+	/*
+	 * The field is only there when esr & if_mask == if_value and, if
+	 * unless_mask is set, esr & unless_mask != unless_value.
+	 */
+	u64 if_mask;
+	u64 if_value;
+	u64 unless_mask;
+	u64 unless_value;
+	/* Sets the desc of a decoded field, may be NULL. */
+	void (*describe)(struct bitfield *field);
+};
+
+/* The field is RES0, and a non-zero value is an error. */
+#define ESR_FIELD_RES0 0x1
+
+/*
+ * The ISS fields of the exception class @ec are what esr_decode() gives after
+ * the EC and IL of an ESR of the class. Store the @i-th of them in print
+ * order, with @i below esr_ec_nr_fields(@ec), to @field without decoding
+ * anything.
+ */
+size_t esr_ec_nr_fields(u64 ec);
+void esr_ec_field(u64 ec, size_t i, struct esr_field *field);
+
+/*
+ * Short name of the exception class @ec, such as DABT_CUR, as in Linux's
+ * ESR_ELx_EC_* constants. NULL if the class is not allocated.
+ */
+const char *esr_ec_name(u64 ec);
+
+/* Description of the exception class @ec. */
+const char *esr_ec_desc(u64 ec);
+
+/* ISS bits that are RES0 for every ESR of the exception class @ec. */
+u64 esr_iss_res0_mask(u64 ec);
+
+/*
+ * Bits of @esr that tell faults apart when aggregating: the EC and, depending
+ * on the class, the fault status code, WnR, S1PTW, SET/AET, the trapped system
+ * register or the immediate. Register numbers and other per-instance detail
+ * are left out. The masked ESR is still a valid ESR, and masking it again
+ * gives the same mask.
+ */
+u64 esr_summary_mask(u64 esr);
+
+/*
+ * @esr with everything outside esr_summary_mask() cleared: faults with the
+ * same signature are the same fault, seen with different registers. It
+ * always fits in the low 32 bits.
+ */
+u64 esr_signature(u64 esr);
+
+/*
+ * A hash of the decoder's tables: classes, field layouts, the descriptions
+ * of every code up to six bits and system register names. Decodes kept
+ * across runs can be checked against it to find out whether they are stale.
+ */
+u64 esr_tables_hash(void);
+
+/* A field at the same bits of every ESR, see esr_extract(). */
+struct esr_extract {
+	unsigned int start;
+	/* 1 to 32 bits */
+	unsigned int width;
+	u32 *out;
+};
+
+#define ESR_EXTRACT_EC(out) { 26, 6, (out) }
+#define ESR_EXTRACT_IL(out) { 25, 1, (out) }
+#define ESR_EXTRACT_ISS(out) { 0, 25, (out) }
+#define ESR_EXTRACT_ISS2(out) { 32, 5, (out) }
+/* Instruction and data aborts */
+#define ESR_EXTRACT_FSC(out) { 0, 6, (out) }
+#define ESR_EXTRACT_WNR(out) { 6, 1, (out) }
+
+/*
+ * For every field in @fields, store the field of each of the @n ESRs at @esr
+ * to its out array, which has room for @n values. Much cheaper per field
+ * than esr_decode() when only a few fields are of interest, for callers that
+ * hold ESRs in arrays. esr_decoder handles a value at a time and does not
+ * use it: a summary key is one table lookup, see esr_signature().
+ */
+void esr_extract(const u64 *esr, size_t n, const struct esr_extract *fields,
+		 size_t nr_fields);
+
+/*
+ * Write the text esr_decoder prints for @esr to @buf, truncated to fit in
+ * @size bytes with the terminating NUL. Like snprintf(), the length of the
+ * whole text is returned. Safe to call from a signal handler: nothing but
+ * the stack and @buf is used, and no libc function is called.
+ */
+size_t esr_format(u64 esr, char *buf, size_t size);
+
+const char *esr_sysreg_name(u64 op0, u64 op1, u64 op2, u64 crn, u64 crm);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef ESRCOL_H
+#define ESRCOL_H
+
+#include <stdint.h>
+
+/*
+ * Columnar export format written by --export, meant to be mmap()ed and read
+ * in place. Everything is in host byte order and 8-byte aligned.
+ *
+ *   struct esrcol_header           at offset 0
+ *   row groups                     column chunks, ESRCOL_GROUP_ROWS rows each
+ *   struct esrcol_footer           at header.footer_offset
+ *   struct esrcol_column           [nr_columns]
+ *   struct esrcol_group            [nr_groups], each followed by
+ *     struct esrcol_chunk          [nr_columns]
+ *   uint32_t string offsets        [nr_strings + 1], at footer.strings_offset
+ *   NUL-terminated strings
+ *
+ * String 0 is the empty string and stands for "none" in dictionary columns.
+ * Column names and field descriptions are string ids.
+ *
+ * A chunk with width 0 has no data: none of the group's rows has that column.
+ * Otherwise, at chunk.offset:
+ *
+ *   ESRCOL_ESR     uint64_t esr[nr_rows]
+ *   ESRCOL_STRING  uint16_t string id[nr_rows]
+ *   ESRCOL_FIELD   uint64_t present bitmap[(nr_rows + 63) / 64]
+ *                  value[nr_rows], chunk.width bytes each, padded to 8 bytes
+ *                  uint16_t description string id[nr_rows]
+ *
+ * A field column holds the decoded field of that name, the same value and
+ * description the text output shows. RES0 fields are not exported.
+ */
+
+#define ESRCOL_MAGIC "ESRCOL1"
+#define ESRCOL_GROUP_ROWS 65536
+
+enum esrcol_kind {
+	ESRCOL_ESR,
+	ESRCOL_STRING,
+	ESRCOL_FIELD,
+};
+
+struct esrcol_header {
+	char magic[8];
+	uint64_t footer_offset;
+};
+
+struct esrcol_footer {
+	uint64_t nr_rows;
+	uint32_t nr_columns;
+	uint32_t nr_groups;
+	uint32_t nr_strings;
+	uint32_t reserved;
+	uint64_t strings_offset;
+};
+
+struct esrcol_column {
+	uint32_t name;
+	uint32_t kind;
+};
+
+struct esrcol_group {
+	uint64_t first_row;
+	uint32_t nr_rows;
+	uint32_t reserved;
+};
+
+struct esrcol_chunk {
+	uint64_t offset;
+	uint32_t width;
+	uint32_t reserved;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef ESRSERVE_H
+#define ESRSERVE_H
+
+#include <stdint.h>
+
+/*
+ * Protocol spoken by --serve over a SOCK_STREAM Unix domain socket, in host
+ * byte order. A client sends any number of requests without waiting for the
+ * replies, which come back in the same order:
+ *
+ *   struct esrserve_request        count ESRs to decode
+ *   uint64_t esr[count]
+ *
+ *   struct esrserve_reply          echoes count
+ *   char text[len]                 what esr_decoder prints for the values,
+ *                                  each labelled with its 0x-prefixed hex
+ *
+ * The text is in the --format the server was started with. A request with a
+ * count above ESRSERVE_BATCH_MAX or nonzero flags gets the connection closed.
+ */
+
+#define ESRSERVE_BATCH_MAX 65536
+
+struct esrserve_request {
+	uint32_t count;
+	uint32_t flags;
+};
+
+struct esrserve_reply {
+	uint32_t count;
+	uint32_t len;
+};
+
+#endif
@@ -0,0 +1,406 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cli.h"
+#include "esrcol.h"
+
+/*
+ * --export writer. Rows of the current group are collected column by column
+ * in memory and written out as one chunk per column when the group is full.
+ * Field columns are created the first time a field of that name is decoded,
+ * so the schema follows whatever the decode_iss_*() functions produce.
+ */
+#define EXPORT_MAX_COLUMNS 256
+#define EXPORT_MAX_STRINGS 65536
+#define EXPORT_STR_BITS 17
+#define EXPORT_STR_SLOTS (1 << EXPORT_STR_BITS)
+
+/* The raw ESR and the trapped system register come first. */
+#define COLUMN_ESR 0
+#define COLUMN_SYSREG 1
+
+struct column {
+	const char *name;
+	enum esrcol_kind kind;
+	uint32_t name_id;
+	/* Set once a row of the current group has the column. */
+	int used;
+	/* Widest field seen in the current group, in bits. */
+	size_t bits;
+
+	uint64_t *present;
+	u64 *values;
+	uint16_t *ids;
+};
+
+struct str_slot {
+	const char *s;
+	uint32_t id;
+};
+
+int export_enabled;
+
+static struct outbuf export_buf;
+static const char *export_path;
+static uint64_t export_offset;
+static uint64_t nr_rows;
+static size_t group_rows;
+
+static struct column columns[EXPORT_MAX_COLUMNS];
+static size_t nr_columns;
+
+/* Dictionary, looked up by pointer first and by contents on a miss. */
+static const char *strings[EXPORT_MAX_STRINGS];
+static size_t nr_strings;
+static struct str_slot ptr_slots[EXPORT_STR_SLOTS];
+static struct str_slot str_slots[EXPORT_STR_SLOTS];
+
+static struct esrcol_group *groups;
+static struct esrcol_chunk *chunks;
+static size_t nr_groups;
+
+static void *xcalloc(size_t n, size_t size)
+{
+	void *p = calloc(n, size);
+
+	if (!p) {
+		perror("malloc");
+		exit(1);
+	}
+	return p;
+}
+
+static size_t ptr_hash(const void *p)
+{
+	return ((unsigned long)p * 0x9e3779b97f4a7c15UL) >>
+	       (64 - EXPORT_STR_BITS);
+}
+
+static size_t str_hash(const char *s)
+{
+	u64 h = 0xcbf29ce484222325UL;
+
+	while (*s) {
+		h = (h ^ (unsigned char)*s++) * 0x100000001b3UL;
+	}
+	return (h * 0x9e3779b97f4a7c15UL) >> (64 - EXPORT_STR_BITS);
+}
+
+/* Dictionary id of @s, 0 for NULL or once the dictionary is full. */
+static uint32_t string_id(const char *s)
+{
+	struct str_slot *slot;
+	size_t i;
+
+	if (!s || !*s) {
+		return 0;
+	}
+
+	for (i = ptr_hash(s); ptr_slots[i].s; i = (i + 1) % EXPORT_STR_SLOTS) {
+		if (ptr_slots[i].s == s) {
+			return ptr_slots[i].id;
+		}
+	}
+	slot = &ptr_slots[i];
+
+	for (i = str_hash(s); str_slots[i].s; i = (i + 1) % EXPORT_STR_SLOTS) {
+		if (!strcmp(str_slots[i].s, s)) {
+			break;
+		}
+	}
+	if (!str_slots[i].s) {
+		if (nr_strings == EXPORT_MAX_STRINGS) {
+			return 0;
+		}
+		str_slots[i].s = s;
+		str_slots[i].id = nr_strings;
+		strings[nr_strings++] = s;
+	}
+
+	/* Decoder strings are static, so neither table gets near full. */
+	slot->s = s;
+	slot->id = str_slots[i].id;
+	return slot->id;
+}
+
+static struct column *column_new(const char *name, enum esrcol_kind kind)
+{
+	struct column *col = &columns[nr_columns++];
+
+	col->name = name;
+	col->kind = kind;
+	col->name_id = string_id(name);
+	if (kind != ESRCOL_STRING) {
+		col->values = xcalloc(ESRCOL_GROUP_ROWS, sizeof(*col->values));
+	}
+	if (kind != ESRCOL_ESR) {
+		col->ids = xcalloc(ESRCOL_GROUP_ROWS, sizeof(*col->ids));
+	}
+	if (kind == ESRCOL_FIELD) {
+		col->present = xcalloc((ESRCOL_GROUP_ROWS + 63) / 64,
+				       sizeof(*col->present));
+	}
+
+	return col;
+}
+
+/* The column of the fields named @name, NULL once there are too many. */
+static struct column *field_column(const char *name)
+{
+	uint32_t id = string_id(name);
+
+	for (size_t i = COLUMN_SYSREG + 1; i < nr_columns; i++) {
+		if (columns[i].name_id == id) {
+			return &columns[i];
+		}
+	}
+
+	if (nr_columns == EXPORT_MAX_COLUMNS) {
+		return NULL;
+	}
+	return column_new(name, ESRCOL_FIELD);
+}
+
+static void export_write(const void *data, size_t len)
+{
+	out_mem(&export_buf, data, len);
+	export_offset += len;
+}
+
+static void export_pad(void)
+{
+	static const char zero[8];
+
+	export_write(zero, -export_offset & 7);
+}
+
+static uint32_t field_bytes(size_t bits)
+{
+	return bits <= 8 ? 1 : bits <= 16 ? 2 : bits <= 32 ? 4 : 8;
+}
+
+/* @n values, each narrowed to @width bytes in host byte order. */
+static void write_values(const u64 *values, size_t n, uint32_t width)
+{
+	for (size_t i = 0; i < n; i++) {
+		uint8_t v8 = values[i];
+		uint16_t v16 = values[i];
+		uint32_t v32 = values[i];
+
+		switch (width) {
+		case 1:
+			export_write(&v8, sizeof(v8));
+			break;
+		case 2:
+			export_write(&v16, sizeof(v16));
+			break;
+		case 4:
+			export_write(&v32, sizeof(v32));
+			break;
+		default:
+			export_write(&values[i], sizeof(u64));
+			break;
+		}
+	}
+}
+
+static void write_chunk(struct column *col, struct esrcol_chunk *chunk)
+{
+	size_t n = group_rows;
+
+	chunk->offset = export_offset;
+	switch (col->kind) {
+	case ESRCOL_ESR:
+		chunk->width = sizeof(u64);
+		export_write(col->values, n * sizeof(u64));
+		break;
+	case ESRCOL_STRING:
+		chunk->width = sizeof(uint16_t);
+		export_write(col->ids, n * sizeof(uint16_t));
+		break;
+	case ESRCOL_FIELD:
+		chunk->width = field_bytes(col->bits);
+		export_write(col->present, (n + 63) / 64 * sizeof(uint64_t));
+		write_values(col->values, n, chunk->width);
+		export_pad();
+		export_write(col->ids, n * sizeof(uint16_t));
+		break;
+	}
+	export_pad();
+}
+
+static void flush_group(void)
+{
+	struct esrcol_group *group;
+
+	if (!group_rows) {
+		return;
+	}
+
+	groups = realloc(groups, (nr_groups + 1) * sizeof(*groups));
+	chunks = realloc(chunks, (nr_groups + 1) * EXPORT_MAX_COLUMNS *
+					 sizeof(*chunks));
+	if (!groups || !chunks) {
+		perror("malloc");
+		exit(1);
+	}
+
+	/* Columns first seen in a later group have no chunk in this one. */
+	memset(&chunks[nr_groups * EXPORT_MAX_COLUMNS], 0,
+	       EXPORT_MAX_COLUMNS * sizeof(*chunks));
+
+	group = &groups[nr_groups];
+	group->first_row = nr_rows - group_rows;
+	group->nr_rows = group_rows;
+	group->reserved = 0;
+
+	for (size_t i = 0; i < nr_columns; i++) {
+		struct column *col = &columns[i];
+		struct esrcol_chunk *chunk =
+			&chunks[nr_groups * EXPORT_MAX_COLUMNS + i];
+
+		if (col->used) {
+			write_chunk(col, chunk);
+		}
+
+		col->used = 0;
+		col->bits = 0;
+		if (col->present) {
+			memset(col->present, 0,
+			       (ESRCOL_GROUP_ROWS + 63) / 64 *
+				       sizeof(*col->present));
+		}
+		if (col->ids) {
+			memset(col->ids, 0,
+			       ESRCOL_GROUP_ROWS * sizeof(*col->ids));
+		}
+	}
+
+	nr_groups++;
+	group_rows = 0;
+}
+
+int export_open(const char *path)
+{
+	struct esrcol_header header = { ESRCOL_MAGIC, 0 };
+	int fd;
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	outbuf_init(&export_buf, fd, STREAM_BUF_SIZE);
+	export_path = path;
+	export_enabled = 1;
+
+	/* The empty string is id 0, "none". */
+	strings[nr_strings++] = "";
+	column_new("ESR", ESRCOL_ESR);
+	column_new("SYSREG", ESRCOL_STRING);
+
+	export_write(&header, sizeof(header));
+	return 0;
+}
+
+void export_add(u64 esr)
+{
+	size_t row = group_rows;
+	struct esr_result res;
+
+	esr_decode(esr, &res);
+
+	columns[COLUMN_ESR].values[row] = esr;
+	columns[COLUMN_ESR].used = 1;
+	if (res.sysreg) {
+		columns[COLUMN_SYSREG].ids[row] = string_id(res.sysreg);
+		columns[COLUMN_SYSREG].used = 1;
+	}
+
+	for (size_t i = 0; i < res.nr_fields; i++) {
+		const struct bitfield *f = &res.fields[i];
+		struct column *col;
+
+		if (!strcmp(f->name, "RES0") || !(col = field_column(f->name))) {
+			continue;
+		}
+
+		col->used = 1;
+		if (f->width > col->bits) {
+			col->bits = f->width;
+		}
+		col->present[row / 64] |= 1UL << (row % 64);
+		col->values[row] = f->value;
+		col->ids[row] = string_id(f->desc);
+	}
+
+	nr_rows++;
+	if (++group_rows == ESRCOL_GROUP_ROWS) {
+		flush_group();
+	}
+}
+
+int export_close(void)
+{
+	struct esrcol_footer footer = { 0 };
+	struct esrcol_header header = { ESRCOL_MAGIC, 0 };
+	uint32_t offset = 0;
+
+	if (!export_enabled) {
+		return 0;
+	}
+
+	flush_group();
+
+	header.footer_offset = export_offset;
+	footer.nr_rows = nr_rows;
+	footer.nr_columns = nr_columns;
+	footer.nr_groups = nr_groups;
+	footer.nr_strings = nr_strings;
+	footer.strings_offset = export_offset + sizeof(footer) +
+				nr_columns * sizeof(struct esrcol_column) +
+				nr_groups * (sizeof(struct esrcol_group) +
+					     nr_columns *
+						     sizeof(struct esrcol_chunk));
+	export_write(&footer, sizeof(footer));
+
+	for (size_t i = 0; i < nr_columns; i++) {
+		struct esrcol_column col = { columns[i].name_id,
+					     columns[i].kind };
+
+		export_write(&col, sizeof(col));
+	}
+
+	/* Groups written before a column existed have no chunk for it. */
+	for (size_t g = 0; g < nr_groups; g++) {
+		export_write(&groups[g], sizeof(groups[g]));
+		export_write(&chunks[g * EXPORT_MAX_COLUMNS],
+			     nr_columns * sizeof(*chunks));
+	}
+
+	for (size_t i = 0; i < nr_strings; i++) {
+		export_write(&offset, sizeof(offset));
+		offset += strlen(strings[i]) + 1;
+	}
+	export_write(&offset, sizeof(offset));
+	for (size_t i = 0; i < nr_strings; i++) {
+		export_write(strings[i], strlen(strings[i]) + 1);
+	}
+	export_pad();
+
+	outbuf_flush(&export_buf);
+	if (pwrite(export_buf.fd, &header, sizeof(header), 0) !=
+		    sizeof(header) ||
+	    close(export_buf.fd)) {
+		fprintf(stderr, "%s: %s\n", export_path, strerror(errno));
+		return -1;
+	}
+	outbuf_free(&export_buf);
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "esr.h"
+
+/*
+ * Batch field extraction. The ESRs are walked in blocks small enough to stay
+ * in L1 while every field is pulled out of them, each field with a shift, a
+ * mask and a narrowing to 32 bits, several ESRs per instruction where the
+ * compiler targets SIMD. Build with -mavx2 or -march=native to use AVX2.
+ */
+#define EXTRACT_BLOCK 512
+
+static void extract_scalar(const u64 *esr, size_t n, unsigned int start,
+			   u32 mask, u32 *out)
+{
+	for (size_t i = 0; i < n; i++) {
+		out[i] = (esr[i] >> start) & mask;
+	}
+}
+
+static void extract_field(const u64 *esr, size_t n, unsigned int start,
+			  u32 mask, u32 *out)
+{
+	size_t i = 0;
+
+#if defined(__AVX2__)
+	const __m128i shift = _mm_cvtsi32_si128(start);
+	const __m256i m = _mm256_set1_epi64x(mask);
+
+	for (; i + 8 <= n; i += 8) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)(esr + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(esr + i + 4));
+		__m256 r;
+
+		a = _mm256_and_si256(_mm256_srl_epi64(a, shift), m);
+		b = _mm256_and_si256(_mm256_srl_epi64(b, shift), m);
+		/* Low halves: a0 a1 b0 b1 | a2 a3 b2 b3, then reorder. */
+		r = _mm256_shuffle_ps(_mm256_castsi256_ps(a),
+				      _mm256_castsi256_ps(b),
+				      _MM_SHUFFLE(2, 0, 2, 0));
+		_mm256_storeu_si256((__m256i *)(out + i),
+				    _mm256_permute4x64_epi64(
+					    _mm256_castps_si256(r),
+					    _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+#elif defined(__SSE2__)
+	const __m128i shift = _mm_cvtsi32_si128(start);
+	const __m128i m = _mm_set1_epi64x(mask);
+
+	for (; i + 4 <= n; i += 4) {
+		__m128i a = _mm_loadu_si128((const __m128i *)(esr + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(esr + i + 2));
+		__m128 r;
+
+		a = _mm_and_si128(_mm_srl_epi64(a, shift), m);
+		b = _mm_and_si128(_mm_srl_epi64(b, shift), m);
+		r = _mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b),
+				   _MM_SHUFFLE(2, 0, 2, 0));
+		_mm_storeu_si128((__m128i *)(out + i), _mm_castps_si128(r));
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const int64x2_t shift = vdupq_n_s64(-(int64_t)start);
+	const uint64x2_t m = vdupq_n_u64(mask);
+
+	for (; i + 4 <= n; i += 4) {
+		uint64x2_t a = vld1q_u64((const uint64_t *)(esr + i));
+		uint64x2_t b = vld1q_u64((const uint64_t *)(esr + i + 2));
+
+		a = vandq_u64(vshlq_u64(a, shift), m);
+		b = vandq_u64(vshlq_u64(b, shift), m);
+		vst1q_u32(out + i, vcombine_u32(vmovn_u64(a), vmovn_u64(b)));
+	}
+#endif
+
+	extract_scalar(esr + i, n - i, start, mask, out + i);
+}
+
+void esr_extract(const u64 *esr, size_t n, const struct esr_extract *fields,
+		 size_t nr_fields)
+{
+	for (size_t i = 0; i < n; i += EXTRACT_BLOCK) {
+		size_t len = n - i < EXTRACT_BLOCK ? n - i : EXTRACT_BLOCK;
+
+		for (size_t j = 0; j < nr_fields; j++) {
+			const struct esr_extract *f = &fields[j];
+
+			extract_field(esr + i, len, f->start,
+				      (u32)((1UL << f->width) - 1), f->out + i);
+		}
+	}
+}
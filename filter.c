@@ -0,0 +1,409 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * --filter EXPR. The grammar is
+ *
+ *   expr    := and ("||" and)*
+ *   and     := unary ("&&" unary)*
+ *   unary   := "!" unary | "(" expr ")" | NAME [cmp]
+ *   cmp     := ("==" | "!=" | "<" | "<=" | ">" | ">=") NUMBER
+ *            | "in" "{" NUMBER [".." NUMBER] ("," NUMBER [".." NUMBER])* "}"
+ *
+ * where NAME is a field name as printed, in any case, and a NAME on its own
+ * means NAME != 0. A comparison on a field the ESR does not have is false,
+ * and one on a name several fields have, such as RES0, is true if it is for
+ * any of them.
+ *
+ * Field positions come from the field layouts of the decoder, so a field
+ * is a guard, a shift and a mask of the raw ESR and nothing is decoded to
+ * reject a value. Only RES0 and a name an EC has more than one field of are
+ * looked up in a real decode.
+ */
+
+enum node_op {
+	NODE_OR,
+	NODE_AND,
+	NODE_NOT,
+	NODE_CMP,
+};
+
+enum pos_kind {
+	/* The EC has no such field. */
+	POS_NONE,
+	POS_BITS,
+	POS_DECODE,
+};
+
+struct field_pos {
+	enum pos_kind kind;
+	unsigned int start;
+	u64 mask;
+	/* As in struct esr_field. */
+	u64 if_mask;
+	u64 if_value;
+	u64 unless_mask;
+	u64 unless_value;
+};
+
+struct range {
+	u64 lo;
+	u64 hi;
+};
+
+struct node {
+	enum node_op op;
+	struct node *left;
+	struct node *right;
+
+	/* NODE_CMP: the value is in one of the ranges, or none if negate. */
+	const char *name;
+	int negate;
+	size_t nr_ranges;
+	struct range *ranges;
+	struct field_pos pos[64];
+};
+
+int filter_enabled;
+
+static struct node *filter_root;
+
+static const char *expr_start;
+static const char *expr_pos;
+
+static void *xcalloc(size_t n, size_t size)
+{
+	void *p = calloc(n, size);
+
+	if (!p) {
+		perror("malloc");
+		exit(1);
+	}
+	return p;
+}
+
+static void filter_error(const char *what)
+{
+	fprintf(stderr, "bad filter: %s at column %zu: %s\n", what,
+		(size_t)(expr_pos - expr_start) + 1, expr_start);
+	exit(1);
+}
+
+/* Where the field @name is in ESRs of class @ec. */
+static void locate(struct field_pos *pos, u64 ec, const char *name)
+{
+	struct esr_field f, found;
+	int nr_found = 0;
+
+	memset(pos, 0, sizeof(*pos));
+	for (size_t i = 0; i < esr_ec_nr_fields(ec); i++) {
+		esr_ec_field(ec, i, &f);
+		if (strcasecmp(f.name, name)) {
+			continue;
+		}
+		if (nr_found++) {
+			pos->kind = POS_DECODE;
+			return;
+		}
+		found = f;
+	}
+	if (!nr_found) {
+		return;
+	}
+
+	pos->kind = POS_BITS;
+	pos->start = found.start;
+	pos->mask = (1UL << (found.end - found.start + 1)) - 1;
+	pos->if_mask = found.if_mask;
+	pos->if_value = found.if_value;
+	pos->unless_mask = found.unless_mask;
+	pos->unless_value = found.unless_value;
+}
+
+static void compile_field(struct node *node, const char *name)
+{
+	static const struct {
+		const char *name;
+		unsigned int start, width;
+	} fixed[] = {
+		{ "EC", 26, 6 },
+		{ "IL", 25, 1 },
+		{ "ISS", 0, 25 },
+		{ "ISS2", 32, 5 },
+	};
+	int found = 0;
+
+	node->name = name;
+	for (size_t i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++) {
+		if (strcasecmp(fixed[i].name, name)) {
+			continue;
+		}
+		/* Every class has these, even if not printed as such. */
+		for (u64 ec = 0; ec < 64; ec++) {
+			node->pos[ec].kind = POS_BITS;
+			node->pos[ec].start = fixed[i].start;
+			node->pos[ec].mask = (1UL << fixed[i].width) - 1;
+		}
+		return;
+	}
+
+	/* Bits 37..63 are RES0 in every class, but in no field layout. */
+	if (!strcasecmp(name, "RES0")) {
+		for (u64 ec = 0; ec < 64; ec++) {
+			node->pos[ec].kind = POS_DECODE;
+		}
+		return;
+	}
+
+	for (u64 ec = 0; ec < 64; ec++) {
+		locate(&node->pos[ec], ec, name);
+		found |= node->pos[ec].kind != POS_NONE;
+	}
+	if (!found) {
+		filter_error("unknown field");
+	}
+}
+
+static void skip_space(void)
+{
+	while (isspace((unsigned char)*expr_pos)) {
+		expr_pos++;
+	}
+}
+
+static int accept(const char *token)
+{
+	size_t len = strlen(token);
+
+	skip_space();
+	if (strncmp(expr_pos, token, len)) {
+		return 0;
+	}
+	expr_pos += len;
+	return 1;
+}
+
+static u64 parse_number(void)
+{
+	const char *start;
+	char *end;
+	u64 val;
+
+	skip_space();
+	start = expr_pos;
+	if (start[0] == '0' && (start[1] | 0x20) == 'b') {
+		val = strtoul(start + 2, &end, 2);
+		if (end == start + 2) {
+			end = (char *)start;
+		}
+	} else {
+		val = strtoul(start, &end, 0);
+	}
+	if (end == start || isalnum((unsigned char)*end) || *end == '_') {
+		filter_error("expected a number");
+	}
+	expr_pos = end;
+	return val;
+}
+
+static void add_range(struct node *node, u64 lo, u64 hi)
+{
+	node->ranges = realloc(node->ranges,
+			       (node->nr_ranges + 1) * sizeof(*node->ranges));
+	if (!node->ranges) {
+		perror("malloc");
+		exit(1);
+	}
+	node->ranges[node->nr_ranges].lo = lo;
+	node->ranges[node->nr_ranges].hi = hi;
+	node->nr_ranges++;
+}
+
+static struct node *parse_cmp(void)
+{
+	struct node *node = xcalloc(1, sizeof(*node));
+	const char *start;
+	char *name;
+	u64 val;
+
+	skip_space();
+	start = expr_pos;
+	while (isalnum((unsigned char)*expr_pos) || *expr_pos == '_') {
+		expr_pos++;
+	}
+	if (expr_pos == start) {
+		filter_error("expected a field name");
+	}
+	name = strndup(start, expr_pos - start);
+	if (!name) {
+		perror("malloc");
+		exit(1);
+	}
+
+	/* Report an unknown name at the name. */
+	expr_pos = start;
+	compile_field(node, name);
+	expr_pos += strlen(name);
+
+	node->op = NODE_CMP;
+	if (accept("==")) {
+		val = parse_number();
+		add_range(node, val, val);
+	} else if (accept("!=")) {
+		val = parse_number();
+		add_range(node, val, val);
+		node->negate = 1;
+	} else if (accept("<=")) {
+		add_range(node, 0, parse_number());
+	} else if (accept(">=")) {
+		add_range(node, parse_number(), ~0UL);
+	} else if (accept("<")) {
+		val = parse_number();
+		if (!val) {
+			filter_error("nothing is below 0");
+		}
+		add_range(node, 0, val - 1);
+	} else if (accept(">")) {
+		val = parse_number();
+		if (val == ~0UL) {
+			filter_error("nothing is above 0xffffffffffffffff");
+		}
+		add_range(node, val + 1, ~0UL);
+	} else if (accept("in")) {
+		if (!accept("{")) {
+			filter_error("expected '{'");
+		}
+		do {
+			u64 lo = parse_number();
+
+			add_range(node, lo, accept("..") ? parse_number() : lo);
+		} while (accept(","));
+		if (!accept("}")) {
+			filter_error("expected '}'");
+		}
+	} else {
+		add_range(node, 0, 0);
+		node->negate = 1;
+	}
+
+	return node;
+}
+
+static struct node *parse_or(void);
+
+static struct node *parse_unary(void)
+{
+	struct node *node;
+
+	if (accept("!")) {
+		node = xcalloc(1, sizeof(*node));
+		node->op = NODE_NOT;
+		node->left = parse_unary();
+		return node;
+	}
+	if (accept("(")) {
+		node = parse_or();
+		if (!accept(")")) {
+			filter_error("expected ')'");
+		}
+		return node;
+	}
+	return parse_cmp();
+}
+
+static struct node *parse_binary(enum node_op op)
+{
+	const char *token = op == NODE_OR ? "||" : "&&";
+	struct node *left;
+
+	left = op == NODE_OR ? parse_binary(NODE_AND) : parse_unary();
+	while (accept(token)) {
+		struct node *node = xcalloc(1, sizeof(*node));
+
+		node->op = op;
+		node->left = left;
+		node->right = op == NODE_OR ? parse_binary(NODE_AND) :
+					      parse_unary();
+		left = node;
+	}
+	return left;
+}
+
+static struct node *parse_or(void)
+{
+	return parse_binary(NODE_OR);
+}
+
+void filter_compile(const char *expr)
+{
+	expr_start = expr_pos = expr;
+	filter_root = parse_or();
+	skip_space();
+	if (*expr_pos) {
+		filter_error("unexpected text");
+	}
+
+	filter_enabled = 1;
+}
+
+static int cmp_match(const struct node *node, u64 val)
+{
+	for (size_t i = 0; i < node->nr_ranges; i++) {
+		if (val >= node->ranges[i].lo && val <= node->ranges[i].hi) {
+			return !node->negate;
+		}
+	}
+	return node->negate;
+}
+
+/* Whether the field, or any of the fields, @node names holds for @esr. */
+static int cmp_eval(const struct node *node, u64 esr)
+{
+	const struct field_pos *pos = &node->pos[ESR_EC(esr)];
+	struct esr_result res;
+
+	switch (pos->kind) {
+	case POS_BITS:
+		if ((esr & pos->if_mask) != pos->if_value ||
+		    (pos->unless_mask &&
+		     (esr & pos->unless_mask) == pos->unless_value)) {
+			return 0;
+		}
+		return cmp_match(node, (esr >> pos->start) & pos->mask);
+	case POS_DECODE:
+		esr_decode(esr, &res);
+		for (size_t i = 0; i < res.nr_fields; i++) {
+			if (!strcasecmp(res.fields[i].name, node->name) &&
+			    cmp_match(node, res.fields[i].value)) {
+				return 1;
+			}
+		}
+		return 0;
+	default:
+		return 0;
+	}
+}
+
+static int eval(const struct node *node, u64 esr)
+{
+	switch (node->op) {
+	case NODE_OR:
+		return eval(node->left, esr) || eval(node->right, esr);
+	case NODE_AND:
+		return eval(node->left, esr) && eval(node->right, esr);
+	case NODE_NOT:
+		return !eval(node->left, esr);
+	case NODE_CMP:
+		break;
+	}
+	return cmp_eval(node, esr);
+}
+
+int filter_match(u64 esr)
+{
+	return eval(filter_root, esr);
+}
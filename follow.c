@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <libgen.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+/*
+ * --follow: decode the ESRs logged from now on, as they are logged. Both
+ * sources are read without blocking until they run dry, then the output is
+ * flushed and the wait blocks, so a burst of faults costs one write() per
+ * burst rather than per fault, and an idle follower costs nothing.
+ */
+
+/* Largest /dev/kmsg record, see CONSOLE_EXT_LOG_MAX. */
+#define KMSG_RECORD_MAX 8192
+
+/* Decode the ESRs in the "prefix;message\n dictionary..." record at @rec. */
+static void kmsg_record(char *rec, size_t len)
+{
+	char *msg = memchr(rec, ';', len);
+	char *end;
+
+	if (!msg) {
+		return;
+	}
+	msg++;
+	end = memchr(msg, '\n', rec + len - msg);
+	scan_range(&stdout_buf, msg, end ? end : rec + len);
+}
+
+static int follow_kmsg(int fd, const char *path)
+{
+	static char rec[KMSG_RECORD_MAX];
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	ssize_t n;
+
+	/* Only records logged from now on. */
+	lseek(fd, 0, SEEK_END);
+	if (fcntl(fd, F_SETFL, O_NONBLOCK)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	for (;;) {
+		n = read(fd, rec, sizeof(rec));
+		if (n > 0) {
+			kmsg_record(rec, n);
+			continue;
+		}
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && errno == EPIPE) {
+			/* Overwritten before they were read. */
+			fprintf(stderr, "%s: records lost\n", path);
+			continue;
+		}
+		if (n == 0 || errno != EAGAIN) {
+			break;
+		}
+
+		outbuf_flush(&stdout_buf);
+		if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+			break;
+		}
+	}
+
+	fprintf(stderr, "%s: %s\n", path, n ? strerror(errno) : "end of file");
+	return -1;
+}
+
+struct tail {
+	const char *path;
+	int fd;
+	struct stat st;
+	/* Bytes of an incomplete last line kept in buf. */
+	size_t len;
+	int skip;
+	char buf[STREAM_BUF_SIZE];
+};
+
+/* Decode the complete lines appended to the file since the last call. */
+static int tail_read(struct tail *t)
+{
+	for (;;) {
+		size_t room = sizeof(t->buf) - t->len;
+		ssize_t n = read(t->fd, t->buf + t->len, room);
+		char *end;
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			fprintf(stderr, "%s: %s\n", t->path, strerror(errno));
+			return -1;
+		}
+		if (n == 0) {
+			return 0;
+		}
+
+		t->len += n;
+		end = memrchr(t->buf, '\n', t->len);
+		if (!end) {
+			if (t->len == sizeof(t->buf)) {
+				fprintf(stderr, "%s: line too long, skipped\n",
+					t->path);
+				t->skip = 1;
+				t->len = 0;
+			}
+			continue;
+		}
+
+		end++;
+		if (t->skip) {
+			/* The rest of the too long line. */
+			char *nl = memchr(t->buf, '\n', end - t->buf) + 1;
+
+			scan_range(&stdout_buf, nl, end);
+			t->skip = 0;
+		} else {
+			scan_range(&stdout_buf, t->buf, end);
+		}
+		t->len = t->buf + t->len - end;
+		memmove(t->buf, end, t->len);
+	}
+}
+
+/* Open the file now at t->path, a new one, so from its start. */
+static int tail_open(struct tail *t)
+{
+	t->fd = open(t->path, O_RDONLY | O_CLOEXEC);
+	if (t->fd < 0) {
+		return -1;
+	}
+	fstat(t->fd, &t->st);
+	t->len = 0;
+	t->skip = 0;
+	return 0;
+}
+
+/*
+ * Catch up with the file being truncated or replaced since it was opened, as
+ * log rotation does. Either way it is read again from the start.
+ */
+static void tail_check(struct tail *t)
+{
+	struct stat st;
+	off_t pos = lseek(t->fd, 0, SEEK_CUR);
+
+	if (stat(t->path, &st)) {
+		/* Gone for now, it is reopened when it shows up again. */
+		return;
+	}
+
+	if (st.st_ino != t->st.st_ino || st.st_dev != t->st.st_dev) {
+		/* Finish the old file before switching over. */
+		tail_read(t);
+		close(t->fd);
+		if (tail_open(t)) {
+			fprintf(stderr, "%s: %s\n", t->path, strerror(errno));
+		}
+	} else if (st.st_size < pos) {
+		/* Truncated: start over, as with a new file. */
+		lseek(t->fd, 0, SEEK_SET);
+		t->len = 0;
+		t->skip = 0;
+	}
+}
+
+/* Whether the inotify events at @buf name the file @base. */
+static int tail_event(const char *buf, size_t len, const char *base)
+{
+	const struct inotify_event *ev;
+
+	for (size_t i = 0; i < len; i += sizeof(*ev) + ev->len) {
+		ev = (const struct inotify_event *)(buf + i);
+		if (ev->len && !strcmp(ev->name, base)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int follow_file(int fd, const char *path)
+{
+	static struct tail t;
+	char events[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	char dir[PATH_MAX];
+	char base[PATH_MAX];
+	int ifd;
+
+	t.path = path;
+	t.fd = fd;
+	fstat(fd, &t.st);
+	lseek(fd, 0, SEEK_END);
+
+	/*
+	 * Watching the directory rather than the file also sees the file
+	 * being replaced, and the new one being written.
+	 */
+	snprintf(dir, sizeof(dir), "%s", path);
+	snprintf(base, sizeof(base), "%s", basename(dir));
+	snprintf(dir, sizeof(dir), "%s", path);
+	ifd = inotify_init1(IN_CLOEXEC);
+	if (ifd < 0 ||
+	    inotify_add_watch(ifd, dirname(dir), IN_MODIFY | IN_CREATE |
+						 IN_MOVED_TO) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	for (;;) {
+		ssize_t n;
+
+		if (t.fd >= 0) {
+			tail_check(&t);
+		} else {
+			tail_open(&t);
+		}
+		if (t.fd >= 0 && tail_read(&t)) {
+			break;
+		}
+		outbuf_flush(&stdout_buf);
+
+		/* Sleep through what happens to other files in there. */
+		do {
+			n = read(ifd, events, sizeof(events));
+		} while (n > 0 && !tail_event(events, n, base));
+		if (n < 0 && errno != EINTR) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			break;
+		}
+	}
+
+	close(ifd);
+	if (t.fd >= 0) {
+		close(t.fd);
+	}
+	return -1;
+}
+
+int follow(const char *path)
+{
+	struct stat st;
+	int fd;
+	int ret;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0 || fstat(fd, &st)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (!S_ISCHR(st.st_mode)) {
+		return follow_file(fd, path);
+	}
+
+	ret = follow_kmsg(fd, path);
+	close(fd);
+	return ret;
+}
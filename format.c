@@ -0,0 +1,126 @@
+#include "esr.h"
+
+/*
+ * esr_format(): the text of esr_print(), into a buffer of the caller's. It
+ * is meant for crash handlers and early firmware, so it only touches the
+ * stack and the buffer, calls nothing but esr_decode(), and takes time
+ * bounded by ESR_MAX_FIELDS fields of bounded length.
+ */
+struct fmt {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static void fmt_char(struct fmt *f, char c)
+{
+	if (f->len < f->size) {
+		f->buf[f->len] = c;
+	}
+	f->len++;
+}
+
+static void fmt_str(struct fmt *f, const char *s)
+{
+	while (*s) {
+		fmt_char(f, *s++);
+	}
+}
+
+static void fmt_dec(struct fmt *f, u64 val, int min_digits)
+{
+	char tmp[20];
+	int n = 0;
+
+	do {
+		tmp[n++] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+	while (n < min_digits) {
+		tmp[n++] = '0';
+	}
+	while (n) {
+		fmt_char(f, tmp[--n]);
+	}
+}
+
+static void fmt_hex(struct fmt *f, u64 val, int min_digits)
+{
+	int n = (64 - __builtin_clzl(val | 1) + 3) / 4;
+
+	if (n < min_digits) {
+		n = min_digits;
+	}
+	while (n--) {
+		fmt_char(f, "0123456789abcdef"[(val >> (4 * n)) & 0xf]);
+	}
+}
+
+static void fmt_bin(struct fmt *f, u64 val, size_t width)
+{
+	while (width--) {
+		fmt_char(f, '0' + ((val >> width) & 1));
+	}
+}
+
+static void fmt_field(struct fmt *f, const struct bitfield *field)
+{
+	fmt_dec(f, field->start, 2);
+	if (field->width == 1) {
+		fmt_char(f, '\t');
+		fmt_str(f, field->name);
+		fmt_str(f, field->value == 1 ? ":\ttrue" : ":\tfalse");
+	} else {
+		fmt_str(f, "...");
+		fmt_dec(f, field->start + field->width - 1, 2);
+		fmt_char(f, '\t');
+		fmt_str(f, field->name);
+		fmt_str(f, ":\t0x");
+		fmt_hex(f, field->value, 2);
+		fmt_str(f, " 0b");
+		fmt_bin(f, field->value, field->width);
+	}
+
+	if (field->long_name) {
+		fmt_str(f, " (");
+		fmt_str(f, field->long_name);
+		fmt_char(f, ')');
+	}
+
+	if (field->desc) {
+		fmt_str(f, "\t# ");
+		fmt_str(f, field->desc);
+	}
+	fmt_char(f, '\n');
+}
+
+size_t esr_format(u64 esr, char *buf, size_t size)
+{
+	struct fmt f = { buf, size ? size - 1 : 0, 0 };
+	struct esr_result res;
+
+	esr_decode(esr, &res);
+
+	for (size_t i = 0; i < res.nr_fields; i++) {
+		fmt_field(&f, &res.fields[i]);
+	}
+
+	if (res.sysreg && res.sysreg_dir) {
+		fmt_str(&f, "# MRS x");
+		fmt_dec(&f, res.sysreg_rt, 0);
+		fmt_str(&f, ", ");
+		fmt_str(&f, res.sysreg);
+		fmt_char(&f, '\n');
+	} else if (res.sysreg) {
+		fmt_str(&f, "# MSR ");
+		fmt_str(&f, res.sysreg);
+		fmt_str(&f, ", x");
+		fmt_dec(&f, res.sysreg_rt, 0);
+		fmt_char(&f, '\n');
+	}
+
+	if (size) {
+		buf[f.len < f.size ? f.len : f.size] = '\0';
+	}
+	return f.len;
+}
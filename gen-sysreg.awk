@@ -0,0 +1,117 @@
+#!/usr/bin/awk -f
+#
+# Generate sysreg-table.h from the sysreg encoding list.
+#
+# The names are pooled in sysreg_pool[] and referenced by 16-bit offsets.
+# sysreg_index[] maps every 16-bit op0:op1:CRn:CRm:op2 encoding to an index
+# into sysreg_names[], 0 ("unknown") for unallocated encodings. ESR_SMALL
+# builds get the allocated encodings sorted, for a binary search, instead.
+
+function fatal(msg)
+{
+	printf("%s:%d: %s\n", FILENAME, FNR, msg) > "/dev/stderr"
+	err = 1
+	exit 1
+}
+
+function field(val, max, what)
+{
+	if (val !~ /^[0-9]+$/ || val + 0 > max)
+		fatal("bad " what " " val)
+	return val + 0
+}
+
+BEGIN {
+	nr = 0
+}
+
+/^#/ || /^[ \t]*$/ {
+	next
+}
+
+$1 == "Sysreg" {
+	if (NF != 7)
+		fatal("expected: Sysreg <name> <op0> <op1> <CRn> <CRm> <op2>")
+
+	name = $2
+	op0 = field($3, 3, "op0")
+	op1 = field($4, 7, "op1")
+	crn = field($5, 15, "CRn")
+	crm = field($6, 15, "CRm")
+	op2 = field($7, 7, "op2")
+	enc = op0 * 16384 + op1 * 2048 + crn * 128 + crm * 8 + op2
+
+	if (name in seen)
+		fatal("duplicate register " name)
+	if (enc in owner)
+		fatal(name " has the same encoding as " owner[enc])
+	seen[name] = 1
+	owner[enc] = name
+
+	nr++
+	names[nr] = name
+	encs[nr] = sprintf("%d, %d, %d, %d, %d", op0, op1, crn, crm, op2)
+	next
+}
+
+{
+	fatal("unknown directive " $1)
+}
+
+END {
+	if (err)
+		exit 1
+
+	print "/* Generated by gen-sysreg.awk, do not edit. */"
+	print ""
+	print "static const char sysreg_pool[] ="
+	print "\t\"unknown\\0\""
+	off[0] = 0
+	len = 8
+	for (i = 1; i <= nr; i++) {
+		printf("\t\"%s\\0\"\n", names[i])
+		off[i] = len
+		len += length(names[i]) + 1
+	}
+	print "\t;"
+	if (len > 65536)
+		fatal("sysreg_pool does not fit 16-bit offsets")
+	print ""
+
+	# Encodings in increasing order, for ESR_SMALL.
+	for (i = 1; i <= nr; i++) {
+		enc = encs[i]
+		split(enc, f, ", ")
+		key[i] = f[1] * 16384 + f[2] * 2048 + f[3] * 128 + f[4] * 8 + f[5]
+		order[i] = i
+	}
+	for (i = 2; i <= nr; i++) {
+		for (j = i; j > 1 && key[order[j - 1]] > key[order[j]]; j--) {
+			t = order[j]
+			order[j] = order[j - 1]
+			order[j - 1] = t
+		}
+	}
+
+	print "#ifdef ESR_SMALL"
+	print "static const unsigned short sysreg_encs[] = {"
+	for (i = 1; i <= nr; i++)
+		printf("\tSYS_REG(%s),\n", encs[order[i]])
+	print "};"
+	print ""
+	print "static const unsigned short sysreg_enc_names[] = {"
+	for (i = 1; i <= nr; i++)
+		printf("\t%d,\n", off[order[i]])
+	print "};"
+	print "#else"
+	print "static const unsigned short sysreg_names[] = {"
+	for (i = 0; i <= nr; i++)
+		printf("\t%d,\n", off[i])
+	print "};"
+	print ""
+	print "static const unsigned short sysreg_index[1 << 16] = {"
+	for (i = 1; i <= nr; i++)
+		printf("\t[SYS_REG(%s)] = %d,\n", encs[i], i)
+	print "};"
+	print "#endif"
+}
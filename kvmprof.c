@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "cli.h"
+
+/*
+ * --kvm-profile: count the system register traps in trace-cmd report or
+ * ftrace text by register, direction and Rt. Two events carry them:
+ *
+ *   kvm_handle_sys_reg: HSR 0x3203df
+ *   kvm_sys_access: PC: ffff80001234 CNTVCT_EL0 (3,3,14,0,2) read
+ *
+ * The first has the whole ESR. The second, on kernels that have it, names
+ * the register but not Rt, so it is only counted in traces without the
+ * first, or every trap would be counted twice. Counts go into a summary
+ * table of their own, keyed by the ESR with everything but EC=0x18 and the
+ * ISS fields naming the access masked off.
+ */
+#define PROFILE_CHUNK_SIZE (1 << 20)
+
+/* ISS: Op0, Op2, Op1, CRn, Rt, CRm and Dir. */
+#define MSR_KEY_MASK ((0x3fUL << 26) | ((1UL << 22) - 1))
+
+/* Set in keys from kvm_sys_access, which do not know Rt. */
+#define KEY_NO_RT (1UL << 63)
+
+static char *skip_spaces(char *p, char *end)
+{
+	while (p < end && *p == ' ') {
+		p++;
+	}
+	return p;
+}
+
+static char *parse_dec(char *p, char *end, u64 *val)
+{
+	char *start = p;
+
+	for (*val = 0; p < end && *p >= '0' && *p <= '9'; p++) {
+		*val = *val * 10 + *p - '0';
+	}
+	return p > start ? p : NULL;
+}
+
+/* "HSR 0x..." */
+static void profile_handle_sys_reg(char *p, char *end)
+{
+	u64 esr;
+
+	p = skip_spaces(p, end);
+	if (end - p < 6 || memcmp(p, "HSR 0x", 6)) {
+		return;
+	}
+	esr = strtoul(p + 6, NULL, 16);
+	if (ESR_EC(esr) == 0x18) {
+		summary_count(SUMMARY_KVM, esr & MSR_KEY_MASK);
+	}
+}
+
+/* "PC: ... NAME (op0,op1,crn,crm,op2) read|write" */
+static void profile_sys_access(char *p, char *end)
+{
+	static const int shift[] = { 20, 14, 10, 1, 17 };
+	u64 key = KEY_NO_RT | (0x18UL << 26);
+	u64 val;
+
+	p = memchr(p, '(', end - p);
+	if (!p) {
+		return;
+	}
+	for (int i = 0; i < 5; i++) {
+		p = parse_dec(p + 1, end, &val);
+		if (!p || p == end || *p != (i < 4 ? ',' : ')')) {
+			return;
+		}
+		key |= val << shift[i];
+	}
+
+	p = skip_spaces(p + 1, end);
+	if (end - p >= 4 && !memcmp(p, "read", 4)) {
+		key |= 1;
+	}
+	summary_count(SUMMARY_KVM, key);
+}
+
+/*
+ * Count the traps in the trace lines in [start, end). Other events are
+ * skipped over by looking for "_sys_", which both event names have.
+ */
+static void profile_lines(char *start, char *end)
+{
+	char *p = start;
+
+	while ((p = memmem(p, end - p, "_sys_", 5)) != NULL) {
+		char *eol = memchr(p, '\n', end - p);
+
+		if (!eol) {
+			eol = end;
+		}
+		if (p - start >= 10 && eol - p >= 9 &&
+		    !memcmp(p - 10, "kvm_handle_sys_reg:", 19)) {
+			profile_handle_sys_reg(p + 9, eol);
+		} else if (p - start >= 3 && eol - p >= 12 &&
+			   !memcmp(p - 3, "kvm_sys_access:", 15)) {
+			profile_sys_access(p + 12, eol);
+		}
+		p = eol;
+	}
+}
+
+/* For the pool, which hands every range an output buffer that stays empty. */
+static void profile_range(struct outbuf *out, char *start, char *end)
+{
+	(void)out;
+	profile_lines(start, end);
+}
+
+/*
+ * The timestamp of the trace line at @line: the "1234.567890:" field after
+ * the "[cpu]" one, with latency flags possibly in between.
+ */
+static int line_timestamp(char *line, char *end, double *ts)
+{
+	char *p = memchr(line, ']', end - line);
+
+	while (p && p < end) {
+		char *tok = skip_spaces(p + 1, end);
+		char *next;
+
+		*ts = strtod(tok, &next);
+		if (next > tok && next < end && *next == ':') {
+			return 0;
+		}
+		p = memchr(tok, ' ', end - tok);
+	}
+	return -1;
+}
+
+/* Seconds between the first and the last timestamped line of the trace. */
+static double trace_duration(char *map, size_t size)
+{
+	char *end = map + size;
+	double first = 0, last = 0;
+	char *line, *eol, *nl;
+	int found = 0;
+
+	for (line = map; line < end && !found; line = eol + 1) {
+		eol = memchr(line, '\n', end - line);
+		if (!eol) {
+			eol = end;
+		}
+		found = !line_timestamp(line, eol, &first);
+	}
+
+	for (eol = end; found && eol > map; eol = nl) {
+		nl = memrchr(map, '\n', eol - map);
+		line = nl ? nl + 1 : map;
+		if (line < eol && !line_timestamp(line, eol, &last)) {
+			break;
+		}
+		if (!nl) {
+			break;
+		}
+	}
+
+	return last > first ? last - first : 0;
+}
+
+static void profile_print(FILE *out, double secs)
+{
+	struct summary_entry *entries;
+	unsigned long total;
+	size_t n = summary_sorted(SUMMARY_KVM, &entries, &total);
+	size_t nr_rt = 0;
+
+	/* Drop the kvm_sys_access counts if kvm_handle_sys_reg has them. */
+	for (size_t i = 0; i < n; i++) {
+		nr_rt += !(entries[i].key & KEY_NO_RT);
+	}
+	if (nr_rt && nr_rt < n) {
+		size_t j = 0;
+
+		for (size_t i = 0; i < n; i++) {
+			if (entries[i].key & KEY_NO_RT) {
+				total -= entries[i].count;
+			} else {
+				entries[j++] = entries[i];
+			}
+		}
+		n = j;
+	}
+
+	fprintf(out, "%12s %7s %12s  %s\n", "COUNT", "SHARE", "PER_SEC",
+		"ACCESS");
+	for (size_t i = 0; i < n && i < summary_top; i++) {
+		u64 key = entries[i].key;
+		struct esr_result res;
+
+		esr_decode(key & ~KEY_NO_RT, &res);
+		fprintf(out, "%12lu %6.2f%% ", entries[i].count,
+			100.0 * entries[i].count / total);
+		if (secs) {
+			fprintf(out, "%12.1f  ", entries[i].count / secs);
+		} else {
+			fprintf(out, "%12s  ", "-");
+		}
+
+		if (key & KEY_NO_RT) {
+			fprintf(out, "%s %s\n", res.sysreg_dir ? "MRS" : "MSR",
+				res.sysreg);
+		} else if (res.sysreg_dir) {
+			fprintf(out, "MRS x%lu, %s\n", res.sysreg_rt,
+				res.sysreg);
+		} else {
+			fprintf(out, "MSR %s, x%lu\n", res.sysreg,
+				res.sysreg_rt);
+		}
+	}
+	fprintf(out, "%12lu total, %zu distinct, %.3f seconds\n", total, n,
+		secs);
+
+	free(entries);
+}
+
+int kvm_profile(const char *path, int nr_threads)
+{
+	size_t size;
+	char *map;
+
+	if (map_file(path, &map, &size)) {
+		return -1;
+	}
+
+	if (map && nr_threads > 1) {
+		struct pool *pool = pool_create(nr_threads, profile_range,
+						PROFILE_CHUNK_SIZE);
+
+		pool_render(pool, map, map + size);
+		pool_destroy(pool);
+	} else if (map) {
+		profile_lines(map, map + size);
+	}
+
+	/* After anything decoded so far, and before anything decoded later. */
+	outbuf_flush(&stdout_buf);
+	profile_print(stdout, map ? trace_duration(map, size) : 0);
+	fflush(stdout);
+
+	if (map) {
+		munmap(map, size);
+	}
+	return 0;
+}
@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+/* Upper bound for -j, well above the core counts we run on. */
+#define MAX_THREADS 256
+
+static int parse_threads(const char *arg)
+{
+	char *end;
+	long n = strtol(arg, &end, 10);
+
+	if (*arg == '\0' || *end != '\0' || n < 1 || n > MAX_THREADS) {
+		fprintf(stderr, "bad thread count: %s\n", arg);
+		exit(1);
+	}
+
+	return n;
+}
+
+static size_t parse_top(const char *arg)
+{
+	char *end;
+	long n = strtol(arg, &end, 10);
+
+	if (*arg == '\0' || *end != '\0' || n < 1) {
+		fprintf(stderr, "bad row count: %s\n", arg);
+		exit(1);
+	}
+
+	return n;
+}
+
+static enum output_format parse_format(const char *arg)
+{
+	if (!strcmp(arg, "text")) {
+		return FORMAT_TEXT;
+	}
+	if (!strcmp(arg, "json")) {
+		return FORMAT_JSON;
+	}
+	if (!strcmp(arg, "oneline")) {
+		return FORMAT_ONELINE;
+	}
+
+	fprintf(stderr, "bad output format: %s\n", arg);
+	exit(1);
+}
+
+/* Parse a comma separated list of exception classes into a mask. */
+static u64 parse_ec_mask(const char *arg)
+{
+	const char *p = arg;
+	u64 mask = 0;
+
+	for (;;) {
+		char *end;
+		unsigned long ec = strtoul(p, &end, 0);
+
+		if (end == p || ec > 0x3f || (*end != ',' && *end != '\0')) {
+			fprintf(stderr, "bad exception class list: %s\n", arg);
+			exit(1);
+		}
+		mask |= 1UL << ec;
+		if (*end == '\0') {
+			return mask;
+		}
+		p = end + 1;
+	}
+}
+
+static void flush_stdout(void)
+{
+	outbuf_flush(&stdout_buf);
+}
+
+static void cache_conflict(void)
+{
+	fprintf(stderr, "--cache-file does not work with --no-cache\n");
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *cache_file = NULL;
+	int cache_report = 0;
+	int nr_threads = 1;
+	int ret = 0;
+
+	if (argc < 2) {
+		printf("bad input\n");
+		exit(1);
+	}
+
+	setvbuf(stdout, NULL, _IOFBF, STREAM_BUF_SIZE);
+	atexit(flush_stdout);
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-j")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			nr_threads = parse_threads(argv[i]);
+		} else if (!strncmp(argv[i], "-j", 2)) {
+			nr_threads = parse_threads(argv[i] + 2);
+		} else if (!strcmp(argv[i], "--ec")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			ec_mask = parse_ec_mask(argv[i]);
+		} else if (!strcmp(argv[i], "--filter")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			filter_compile(argv[i]);
+		} else if (!strcmp(argv[i], "--format")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			output_format = parse_format(argv[i]);
+		} else if (!strncmp(argv[i], "--format=", 9)) {
+			output_format = parse_format(argv[i] + 9);
+		} else if (!strcmp(argv[i], "--oneline")) {
+			output_format = FORMAT_ONELINE;
+		} else if (!strcmp(argv[i], "--decimal")) {
+			parse_decimal = 1;
+		} else if (!strcmp(argv[i], "--group-by-signature")) {
+			group_by_signature = 1;
+		} else if (!strcmp(argv[i], "--summary")) {
+			summary_enabled = 1;
+		} else if (!strcmp(argv[i], "--top")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			summary_top = parse_top(argv[i]);
+		} else if (!strcmp(argv[i], "--export")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			if (export_open(argv[i])) {
+				exit(1);
+			}
+		} else if (!strcmp(argv[i], "--kvm-profile")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			if (kvm_profile(argv[i], nr_threads)) {
+				ret = 1;
+			}
+		} else if (!strcmp(argv[i], "--follow")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			exit(follow(argv[i]) ? 1 : 0);
+		} else if (!strcmp(argv[i], "--serve")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			exit(serve(argv[i]) ? 1 : 0);
+		} else if (!strcmp(argv[i], "--client")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			/* The rest of the arguments are values to decode. */
+			if (serve_client(argv[i], argv + i + 1, argc - i - 1)) {
+				ret = 1;
+			}
+			break;
+		} else if (!strcmp(argv[i], "--stats")) {
+			stats_start();
+		} else if (!strcmp(argv[i], "--stats=json")) {
+			stats_json = 1;
+			stats_start();
+		} else if (!strcmp(argv[i], "--cache-file")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			/* It is read and filled through the decode cache. */
+			if (!cache_enabled) {
+				cache_conflict();
+			}
+			cache_file = argv[i];
+			if (diskcache_open(cache_file)) {
+				ret = 1;
+			}
+		} else if (!strcmp(argv[i], "--no-cache")) {
+			if (cache_file) {
+				cache_conflict();
+			}
+			cache_enabled = 0;
+		} else if (!strcmp(argv[i], "--cache-stats")) {
+			cache_report = 1;
+		} else if (!strcmp(argv[i], "-")) {
+			if (decode_fd(STDIN_FILENO, "<stdin>", nr_threads)) {
+				ret = 1;
+			}
+		} else if (!strcmp(argv[i], "--input")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			if (decode_file(argv[i], nr_threads)) {
+				ret = 1;
+			}
+		} else if (!strcmp(argv[i], "--scan")) {
+			if (++i == argc) {
+				printf("bad input\n");
+				exit(1);
+			}
+			if (scan_file(argv[i], nr_threads)) {
+				ret = 1;
+			}
+		} else {
+			decode_token(&stdout_buf, argv[i]);
+		}
+	}
+
+	outbuf_flush(&stdout_buf);
+
+	if (export_close()) {
+		ret = 1;
+	}
+
+	if (diskcache_close()) {
+		ret = 1;
+	}
+
+	if (summary_enabled) {
+		summary_print(stdout);
+	}
+
+	if (group_by_signature) {
+		unsigned long seen;
+		size_t distinct;
+
+		signature_stats(&seen, &distinct);
+		fprintf(stderr, "signatures: %zu distinct in %lu values\n",
+			distinct, seen);
+	}
+
+	if (stats_enabled) {
+		stats_print(stderr);
+	}
+
+	if (cache_report) {
+		unsigned long hits, misses;
+
+		cache_stats(&hits, &misses);
+		fprintf(stderr, "cache: %lu hits, %lu misses\n", hits, misses);
+	}
+
+	return ret || parse_failed;
+}
@@ -0,0 +1,152 @@
+#include <pthread.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * --oneline: "<input> <EC name> FIELD=value(desc) ..." per ESR, with the
+ * fields of its signature, see esr_summary_mask(), and the accessed register
+ * for trapped MSR/MRS. Only codes of more than one bit are described. Which
+ * fields those are is worked out once per EC from the field layouts, along
+ * with the text around their values, so printing a line only reads bits of
+ * the ESR and never decodes it.
+ */
+struct oneline_field {
+	struct esr_field layout;
+	/* " NAME=" */
+	char head[24];
+	size_t head_len;
+};
+
+struct oneline_template {
+	/* " DABT_CUR" */
+	char head[24];
+	size_t head_len;
+	size_t nr_fields;
+	struct oneline_field fields[ESR_MAX_FIELDS];
+};
+
+static struct oneline_template templates[64];
+static pthread_once_t templates_once = PTHREAD_ONCE_INIT;
+
+static size_t head_init(char *head, size_t size, const char *s, char sep)
+{
+	size_t len = strlen(s);
+
+	if (len > size - 2) {
+		len = size - 2;
+	}
+	head[0] = ' ';
+	memcpy(head + 1, s, len);
+	if (sep) {
+		head[++len] = sep;
+	}
+	return len + 1;
+}
+
+static void templates_init(void)
+{
+	for (u64 ec = 0; ec < 64; ec++) {
+		struct oneline_template *t = &templates[ec];
+		u64 key = esr_summary_mask(ec << 26) & ((1UL << 25) - 1);
+
+		if (esr_ec_name(ec)) {
+			t->head_len = head_init(t->head, sizeof(t->head),
+						esr_ec_name(ec), 0);
+		} else {
+			t->head_len = head_init(t->head, sizeof(t->head), "EC",
+						'=');
+		}
+
+		/* The register name says all its fields do. */
+		if (ec == 0x18) {
+			continue;
+		}
+
+		for (size_t i = 0; i < esr_ec_nr_fields(ec); i++) {
+			struct oneline_field *of = &t->fields[t->nr_fields];
+			struct esr_field *f = &of->layout;
+			u64 mask;
+
+			esr_ec_field(ec, i, f);
+			mask = ((2UL << (f->end - f->start)) - 1) << f->start;
+			if ((key & mask) != mask || (f->flags & ESR_FIELD_RES0)) {
+				continue;
+			}
+			t->nr_fields++;
+			of->head_len = head_init(of->head, sizeof(of->head),
+						 f->name, '=');
+		}
+	}
+}
+
+void oneline_render(struct outbuf *out, const char *token, size_t len, u64 esr)
+{
+	const struct oneline_template *t;
+	u64 ec = ESR_EC(esr);
+
+	pthread_once(&templates_once, templates_init);
+	t = &templates[ec];
+
+	out_mem(out, token, len);
+	out_mem(out, t->head, t->head_len);
+	if (!esr_ec_name(ec)) {
+		out_lit(out, "0x");
+		out_hex(out, ec, 2);
+	}
+
+	for (size_t i = 0; i < t->nr_fields; i++) {
+		const struct esr_field *f = &t->fields[i].layout;
+		struct bitfield field;
+
+		if ((esr & f->if_mask) != f->if_value ||
+		    (f->unless_mask &&
+		     (esr & f->unless_mask) == f->unless_value)) {
+			continue;
+		}
+
+		field.name = f->name;
+		field.long_name = f->long_name;
+		field.start = f->start;
+		field.width = f->end - f->start + 1;
+		field.value = (esr >> f->start) & ((1UL << field.width) - 1);
+		field.desc = NULL;
+
+		out_mem(out, t->fields[i].head, t->fields[i].head_len);
+		if (field.width == 1) {
+			out_char(out, '0' + field.value);
+		} else {
+			out_lit(out, "0x");
+			out_hex(out, field.value, 2);
+		}
+		if (field.width > 1 && f->describe) {
+			f->describe(&field);
+		}
+		if (field.desc) {
+			out_char(out, '(');
+			out_str(out, field.desc);
+			out_char(out, ')');
+		}
+	}
+
+	if (ec == 0x18) {
+		const char *name = esr_sysreg_name((esr >> 20) & 0x3,
+						   (esr >> 14) & 0x7,
+						   (esr >> 17) & 0x7,
+						   (esr >> 10) & 0xf,
+						   (esr >> 1) & 0xf);
+
+		if (esr & 1) {
+			out_lit(out, " MRS x");
+			out_dec(out, (esr >> 5) & 0x1f, 0);
+			out_lit(out, ", ");
+			out_str(out, name);
+		} else {
+			out_lit(out, " MSR ");
+			out_str(out, name);
+			out_lit(out, ", x");
+			out_dec(out, (esr >> 5) & 0x1f, 0);
+		}
+	}
+	out_char(out, '\n');
+}
@@ -0,0 +1,238 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+static char stdout_data[STREAM_BUF_SIZE];
+
+struct outbuf stdout_buf = {
+	.buf = stdout_data,
+	.size = sizeof(stdout_data),
+	.fd = STDOUT_FILENO,
+};
+
+void outbuf_init(struct outbuf *ob, int fd, size_t size)
+{
+	ob->buf = malloc(size);
+	if (!ob->buf) {
+		perror("malloc");
+		exit(1);
+	}
+	ob->len = 0;
+	ob->size = size;
+	ob->fd = fd;
+}
+
+void outbuf_free(struct outbuf *ob)
+{
+	free(ob->buf);
+	ob->buf = NULL;
+	ob->len = ob->size = 0;
+}
+
+static void write_iov(struct outbuf *ob, struct iovec *iov, int cnt)
+{
+	u64 t = stats_enabled ? stats_clock() : 0;
+	size_t total = 0;
+
+	for (int i = 0; i < cnt; i++) {
+		total += iov[i].iov_len;
+	}
+
+	while (cnt) {
+		ssize_t n = writev(ob->fd, iov, cnt);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			perror("write");
+			exit(1);
+		}
+
+		for (; cnt && (size_t)n >= iov->iov_len; iov++, cnt--) {
+			n -= iov->iov_len;
+		}
+		if (cnt) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	if (stats_enabled) {
+		stats_stage(STAGE_WRITE, stats_clock() - t);
+		/* Not --export or --cache-file, which use buffers of their own. */
+		if (ob == &stdout_buf) {
+			stats_bytes(0, total);
+		}
+	}
+}
+
+void outbuf_flush(struct outbuf *ob)
+{
+	struct iovec iov = { ob->buf, ob->len };
+
+	if (ob->fd < 0 || !ob->len) {
+		return;
+	}
+	write_iov(ob, &iov, 1);
+	ob->len = 0;
+}
+
+void outbuf_grow(struct outbuf *ob, size_t n)
+{
+	if (ob->fd >= 0) {
+		outbuf_flush(ob);
+		return;
+	}
+
+	while (ob->size - ob->len < n) {
+		ob->size = ob->size ? ob->size * 2 : 4096;
+	}
+	ob->buf = realloc(ob->buf, ob->size);
+	if (!ob->buf) {
+		perror("malloc");
+		exit(1);
+	}
+}
+
+/*
+ * Append @len bytes at @data. Data that would not fit into an emptied buffer
+ * anyway goes out in the same writev() as the buffered bytes, rather than
+ * being copied through the buffer.
+ */
+void outbuf_write(struct outbuf *ob, const void *data, size_t len)
+{
+	if (ob->fd >= 0 && len >= ob->size) {
+		struct iovec iov[2] = {
+			{ ob->buf, ob->len },
+			{ (void *)data, len },
+		};
+
+		write_iov(ob, iov, 2);
+		ob->len = 0;
+		return;
+	}
+
+	memcpy(out_reserve(ob, len), data, len);
+	ob->len += len;
+}
+
+void __out_dec(struct outbuf *ob, u64 val, int min_digits)
+{
+	char tmp[20];
+	int n = 0;
+
+	do {
+		tmp[n++] = '0' + val % 10;
+		val /= 10;
+	} while (val);
+	while (n < min_digits) {
+		tmp[n++] = '0';
+	}
+
+	char *p = out_reserve(ob, n);
+
+	ob->len += n;
+	while (n) {
+		*p++ = tmp[--n];
+	}
+}
+
+void out_hex(struct outbuf *ob, u64 val, int min_digits)
+{
+	static const char digits[] = "0123456789abcdef";
+	int n = (64 - __builtin_clzl(val | 1) + 3) / 4;
+
+	if (n < min_digits) {
+		n = min_digits;
+	}
+
+	char *p = out_reserve(ob, n);
+
+	ob->len += n;
+	for (p += n; n; n--, val >>= 4) {
+		*--p = digits[val & 0xf];
+	}
+}
+
+/* The low @width bits of @val, most significant first. */
+void out_bin(struct outbuf *ob, u64 val, size_t width)
+{
+	static const char nibbles[16][4] = {
+		"0000", "0001", "0010", "0011", "0100", "0101", "0110", "0111",
+		"1000", "1001", "1010", "1011", "1100", "1101", "1110", "1111",
+	};
+	char *p = out_reserve(ob, width);
+	size_t head = width % 4;
+
+	ob->len += width;
+	if (head) {
+		memcpy(p, nibbles[(val >> (width - head)) & 0xf] + 4 - head,
+		       head);
+		p += head;
+	}
+	for (size_t i = width - head; i; i -= 4, p += 4) {
+		memcpy(p, nibbles[(val >> (i - 4)) & 0xf], 4);
+	}
+}
+
+#define ONES 0x0101010101010101UL
+#define HIGHS 0x8080808080808080UL
+
+/* Whether any byte of @x is a control character, '"' or '\\'. */
+static int json_needs_escape(u64 x)
+{
+	u64 quote = x ^ (ONES * '"');
+	u64 bslash = x ^ (ONES * '\\');
+
+	return !!((((x - ONES * 0x20) & ~x) |
+		   ((quote - ONES) & ~quote) |
+		   ((bslash - ONES) & ~bslash)) & HIGHS);
+}
+
+/* @len bytes at @s as a quoted JSON string. */
+void out_json_str(struct outbuf *ob, const char *s, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t run = 0;
+	size_t i = 0;
+
+	out_char(ob, '"');
+	while (i < len) {
+		unsigned char c;
+		u64 x;
+
+		/* Skip over eight bytes at a time that need no escaping. */
+		if (len - i >= 8) {
+			memcpy(&x, s + i, 8);
+			if (!json_needs_escape(x)) {
+				i += 8;
+				continue;
+			}
+		}
+
+		c = s[i++];
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		char esc[6] = { '\\', c, '0', '0' };
+
+		out_mem(ob, s + run, i - 1 - run);
+		run = i;
+		if (c >= 0x20) {
+			out_mem(ob, esc, 2);
+		} else {
+			esc[1] = 'u';
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			out_mem(ob, esc, sizeof(esc));
+		}
+	}
+	out_mem(ob, s + run, len - run);
+	out_char(ob, '"');
+}
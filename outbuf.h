@@ -0,0 +1,84 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <string.h>
+
+#include "esr.h"
+
+/*
+ * Append-only output buffer. A buffer backed by a file descriptor is flushed
+ * with write() when it fills up, a memory buffer (fd < 0) grows instead.
+ */
+struct outbuf {
+	char *buf;
+	size_t len;
+	size_t size;
+	int fd;
+};
+
+extern struct outbuf stdout_buf;
+
+void outbuf_init(struct outbuf *ob, int fd, size_t size);
+void outbuf_free(struct outbuf *ob);
+void outbuf_flush(struct outbuf *ob);
+void outbuf_grow(struct outbuf *ob, size_t n);
+void outbuf_write(struct outbuf *ob, const void *data, size_t len);
+
+/* Make room for @n more bytes and return where they go. */
+static inline char *out_reserve(struct outbuf *ob, size_t n)
+{
+	if (ob->size - ob->len < n) {
+		outbuf_grow(ob, n);
+	}
+	return ob->buf + ob->len;
+}
+
+static inline void out_mem(struct outbuf *ob, const void *data, size_t len)
+{
+	if (ob->size - ob->len < len) {
+		outbuf_write(ob, data, len);
+		return;
+	}
+	memcpy(ob->buf + ob->len, data, len);
+	ob->len += len;
+}
+
+/* A string literal, its length known at compile time. */
+#define out_lit(ob, s) out_mem(ob, s, sizeof(s) - 1)
+
+static inline void out_str(struct outbuf *ob, const char *s)
+{
+	out_mem(ob, s, strlen(s));
+}
+
+static inline void out_char(struct outbuf *ob, char c)
+{
+	*out_reserve(ob, 1) = c;
+	ob->len++;
+}
+
+void __out_dec(struct outbuf *ob, u64 val, int min_digits);
+
+static inline void out_dec(struct outbuf *ob, u64 val, int min_digits)
+{
+	/* Bit positions and most field values take one or two digits. */
+	if (val < 100 && min_digits <= 2) {
+		char *p = out_reserve(ob, 2);
+
+		if (val < 10 && min_digits < 2) {
+			*p = '0' + val;
+			ob->len++;
+		} else {
+			p[0] = '0' + val / 10;
+			p[1] = '0' + val % 10;
+			ob->len += 2;
+		}
+		return;
+	}
+	__out_dec(ob, val, min_digits);
+}
+void out_hex(struct outbuf *ob, u64 val, int min_digits);
+void out_bin(struct outbuf *ob, u64 val, size_t width);
+void out_json_str(struct outbuf *ob, const char *s, size_t len);
+
+#endif
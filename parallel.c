@@ -0,0 +1,437 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+/*
+ * Input is handed to the pool in windows of up to CHUNKS_PER_THREAD *
+ * nr_threads chunks. Every chunk ends on a line boundary and is rendered into
+ * its own memory buffer; the main thread writes the chunks out in input
+ * order while the workers carry on with the rest of the window.
+ */
+#define CHUNKS_PER_THREAD 8
+
+/*
+ * Rendered text is roughly a hundred times larger than its input, so the
+ * streaming decoder keeps chunks small to bound the memory held by rendered
+ * but not yet written chunks.
+ */
+#define STREAM_CHUNK_SIZE (16 << 10)
+
+struct chunk {
+	char *start;
+	char *end;
+	/* Kept across windows, so its memory is only allocated once. */
+	struct outbuf out;
+	int done;
+};
+
+/*
+ * Per-worker run queue holding the chunk index range [head, tail), packed
+ * into one word so that both ends can be claimed with a single CAS. The owner
+ * pops from the head to keep its chunks in input order, thieves take from the
+ * tail.
+ */
+struct queue {
+	unsigned long range;
+} __attribute__((aligned(64)));
+
+struct pool {
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	unsigned long generation;
+	int stop;
+
+	int nr_threads;
+	pthread_t *threads;
+	struct worker *workers;
+	struct queue *queues;
+
+	render_fn render;
+	size_t chunk_size;
+	struct chunk *chunks;
+	size_t max_chunks;
+	size_t nr_chunks;
+};
+
+struct worker {
+	struct pool *pool;
+	int id;
+};
+
+#define RANGE(head, tail) (((unsigned long)(tail) << 32) | (head))
+#define RANGE_HEAD(range) ((range)&0xffffffff)
+#define RANGE_TAIL(range) ((range) >> 32)
+
+static long queue_pop(struct queue *q)
+{
+	unsigned long old = __atomic_load_n(&q->range, __ATOMIC_ACQUIRE);
+	unsigned long head;
+
+	do {
+		head = RANGE_HEAD(old);
+		if (head >= RANGE_TAIL(old)) {
+			return -1;
+		}
+	} while (!__atomic_compare_exchange_n(&q->range, &old,
+					      RANGE(head + 1, RANGE_TAIL(old)),
+					      1, __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
+
+	return head;
+}
+
+static long queue_steal(struct queue *q)
+{
+	unsigned long old = __atomic_load_n(&q->range, __ATOMIC_ACQUIRE);
+	unsigned long tail;
+
+	do {
+		tail = RANGE_TAIL(old);
+		if (RANGE_HEAD(old) >= tail) {
+			return -1;
+		}
+	} while (!__atomic_compare_exchange_n(&q->range, &old,
+					      RANGE(RANGE_HEAD(old), tail - 1),
+					      1, __ATOMIC_ACQ_REL,
+					      __ATOMIC_ACQUIRE));
+
+	return tail - 1;
+}
+
+static long pool_next_chunk(struct pool *pool, int id)
+{
+	long idx = queue_pop(&pool->queues[id]);
+
+	for (int i = 1; idx < 0 && i < pool->nr_threads; i++) {
+		idx = queue_steal(&pool->queues[(id + i) % pool->nr_threads]);
+	}
+
+	return idx;
+}
+
+/* For the workers' messages. */
+static const char *stream_name;
+
+/*
+ * The windows are larger than the serial decoder's buffer, so lines are cut
+ * off here at the same length it cuts them off at.
+ */
+static void decode_checked_line(struct outbuf *out, char *line, char *end)
+{
+	if (end - line >= STREAM_LINE_MAX) {
+		fprintf(stderr, "%s: line too long, skipped\n", stream_name);
+		return;
+	}
+	decode_line(out, line, end);
+}
+
+void decode_lines(struct outbuf *out, char *start, char *end)
+{
+	char *nl;
+
+	while ((nl = memchr(start, '\n', end - start)) != NULL) {
+		decode_checked_line(out, start, nl);
+		start = nl + 1;
+	}
+	if (start < end) {
+		decode_checked_line(out, start, end);
+	}
+}
+
+static void render_chunk(struct pool *pool, struct chunk *chunk)
+{
+	chunk->out.len = 0;
+	pool->render(&chunk->out, chunk->start, chunk->end);
+}
+
+static void *worker_fn(void *arg)
+{
+	struct worker *w = arg;
+	struct pool *pool = w->pool;
+	unsigned long seen = 0;
+	long idx;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		while (pool->generation == seen && !pool->stop) {
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+		}
+		if (pool->stop) {
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		while ((idx = pool_next_chunk(pool, w->id)) >= 0) {
+			render_chunk(pool, &pool->chunks[idx]);
+
+			pthread_mutex_lock(&pool->lock);
+			pool->chunks[idx].done = 1;
+			pthread_cond_broadcast(&pool->done_cond);
+			pthread_mutex_unlock(&pool->lock);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Split [buf, end) into at most max_chunks chunks of about chunk_size bytes
+ * ending on a newline. Returns where the last chunk ends.
+ */
+static char *split_chunks(struct pool *pool, char *buf, char *end)
+{
+	pool->nr_chunks = 0;
+
+	while (buf < end && pool->nr_chunks < pool->max_chunks) {
+		struct chunk *chunk = &pool->chunks[pool->nr_chunks++];
+		char *p = buf + pool->chunk_size;
+		char *nl;
+
+		if (p >= end) {
+			p = end;
+		} else if ((nl = memchr(p, '\n', end - p)) != NULL) {
+			p = nl + 1;
+		} else {
+			p = end;
+		}
+
+		chunk->start = buf;
+		chunk->end = p;
+		chunk->done = 0;
+		buf = p;
+	}
+
+	return buf;
+}
+
+/* Hand the current window to the workers and write it out in order. */
+static void pool_run(struct pool *pool)
+{
+	size_t per_thread = (pool->nr_chunks + pool->nr_threads - 1) /
+			    pool->nr_threads;
+
+	for (int i = 0; i < pool->nr_threads; i++) {
+		size_t head = i * per_thread;
+		size_t tail = head + per_thread;
+
+		if (head > pool->nr_chunks) {
+			head = pool->nr_chunks;
+		}
+		if (tail > pool->nr_chunks) {
+			tail = pool->nr_chunks;
+		}
+		__atomic_store_n(&pool->queues[i].range, RANGE(head, tail),
+				 __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->generation++;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (size_t i = 0; i < pool->nr_chunks; i++) {
+		struct chunk *chunk = &pool->chunks[i];
+
+		pthread_mutex_lock(&pool->lock);
+		while (!chunk->done) {
+			pthread_cond_wait(&pool->done_cond, &pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		outbuf_write(&stdout_buf, chunk->out.buf, chunk->out.len);
+	}
+}
+
+struct pool *pool_create(int nr_threads, render_fn render, size_t chunk_size)
+{
+	struct pool *pool = calloc(1, sizeof(*pool));
+
+	if (!pool) {
+		perror("malloc");
+		exit(1);
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+	pool->nr_threads = nr_threads;
+	pool->render = render;
+	pool->chunk_size = chunk_size;
+	pool->max_chunks = (size_t)nr_threads * CHUNKS_PER_THREAD;
+	pool->threads = calloc(nr_threads, sizeof(*pool->threads));
+	pool->workers = calloc(nr_threads, sizeof(*pool->workers));
+	pool->queues = aligned_alloc(64, nr_threads * sizeof(*pool->queues));
+	pool->chunks = calloc(pool->max_chunks, sizeof(*pool->chunks));
+	if (!pool->threads || !pool->workers || !pool->queues ||
+	    !pool->chunks) {
+		perror("malloc");
+		exit(1);
+	}
+
+	for (size_t i = 0; i < pool->max_chunks; i++) {
+		pool->chunks[i].out.fd = -1;
+	}
+
+	for (int i = 0; i < nr_threads; i++) {
+		pool->queues[i].range = 0;
+		pool->workers[i].pool = pool;
+		pool->workers[i].id = i;
+		if (pthread_create(&pool->threads[i], NULL, worker_fn,
+				   &pool->workers[i])) {
+			perror("pthread_create");
+			exit(1);
+		}
+	}
+
+	return pool;
+}
+
+/*
+ * Render [start, end) on the pool and write the result to stdout in input
+ * order. Chunks are split on newlines, so @render never sees a partial line.
+ */
+void pool_render(struct pool *pool, char *start, char *end)
+{
+	while (start < end) {
+		start = split_chunks(pool, start, end);
+		pool_run(pool);
+	}
+}
+
+void pool_destroy(struct pool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (int i = 0; i < pool->nr_threads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	for (size_t i = 0; i < pool->max_chunks; i++) {
+		outbuf_free(&pool->chunks[i].out);
+	}
+	free(pool->threads);
+	free(pool->workers);
+	free(pool->queues);
+	free(pool->chunks);
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+/* Fill @buf from @fd, returning the number of bytes read or -1 on error. */
+static ssize_t read_full(int fd, char *buf, size_t size, int *eof)
+{
+	size_t len = 0;
+
+	while (len < size) {
+		ssize_t n = read(fd, buf + len, size - len);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			return -1;
+		}
+		if (n == 0) {
+			*eof = 1;
+			break;
+		}
+		len += n;
+	}
+
+	if (stats_enabled) {
+		stats_bytes(len, 0);
+	}
+
+	return len;
+}
+
+/*
+ * Same as decode_stream(), but with the rendering spread over @nr_threads
+ * workers. Output is identical to the single-threaded mode.
+ */
+int decode_stream_parallel(int fd, const char *name, int nr_threads)
+{
+	size_t size = (size_t)nr_threads * CHUNKS_PER_THREAD * STREAM_CHUNK_SIZE;
+	struct pool *pool;
+	char *buf;
+	size_t len = 0;
+	int skip = 0;
+	int eof = 0;
+	int ret = 0;
+
+	if (size < STREAM_BUF_SIZE) {
+		size = STREAM_BUF_SIZE;
+	}
+	buf = malloc(size);
+	if (!buf) {
+		perror("malloc");
+		exit(1);
+	}
+
+	stream_name = name;
+	pool = pool_create(nr_threads, decode_lines, STREAM_CHUNK_SIZE);
+
+	while (!eof) {
+		ssize_t n = read_full(fd, buf + len, size - len, &eof);
+		char *start = buf;
+		char *end;
+
+		if (n < 0) {
+			fprintf(stderr, "%s: %s\n", name, strerror(errno));
+			ret = -1;
+			break;
+		}
+		len += n;
+
+		if (skip) {
+			char *nl = memchr(buf, '\n', len);
+
+			start = nl ? nl + 1 : buf + len;
+			skip = !nl;
+		}
+
+		if (eof) {
+			end = buf + len;
+		} else {
+			end = memrchr(start, '\n', buf + len - start);
+			if (!end) {
+				if (start == buf) {
+					fprintf(stderr,
+						"%s: line too long, skipped\n",
+						name);
+					skip = 1;
+				}
+				/* Keep the line after the skipped one. */
+				len = start == buf ? 0 : buf + len - start;
+				memmove(buf, start, len);
+				continue;
+			}
+			end++;
+		}
+
+		pool_render(pool, start, end);
+
+		len = buf + len - end;
+		memmove(buf, end, len);
+	}
+
+	pool_destroy(pool);
+	free(buf);
+
+	return ret;
+}
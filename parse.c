@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * ESR tokens: hex with or without 0x, or decimal with --decimal, with '_'
+ * allowed between digits. Plain hex of up to 16 digits, which is nearly all
+ * input, is checked and converted eight digits at a time in a u64. Anything
+ * else, and any token the fast path rejects, goes through the loop in
+ * parse_slow(), which also finds what exactly is wrong with a bad token.
+ */
+#define ONES 0x0101010101010101UL
+#define HIGHS 0x8080808080808080UL
+
+int parse_decimal;
+int parse_failed;
+
+/* Eight ASCII characters, the first in the low byte. */
+static u64 load8(const char *p)
+{
+	u64 x;
+
+	memcpy(&x, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	x = __builtin_bswap64(x);
+#endif
+	return x;
+}
+
+/* Whether all eight bytes of @x are hex digits. */
+static int hex8_valid(u64 x)
+{
+	u64 lower = x | 0x20 * ONES;
+	u64 digit, alpha;
+
+	/* Below 0x80 every byte can be offset by up to 0x80 without carry. */
+	if (x & HIGHS) {
+		return 0;
+	}
+	digit = (x + (0x80 - '0') * ONES) & ~(x + (0x80 - '9' - 1) * ONES);
+	alpha = (lower + (0x80 - 'a') * ONES) &
+		~(lower + (0x80 - 'f' - 1) * ONES);
+	return ((digit | alpha) & HIGHS) == HIGHS;
+}
+
+/* The value of the eight hex digits in @x, valid per hex8_valid(). */
+static u64 hex8_value(u64 x)
+{
+	/* Digits are their low nibble, letters that plus 9. */
+	x = (x & 0x0f * ONES) + ((x >> 6) & ONES) * 9;
+
+	x = ((x << 4) | (x >> 8)) & 0x00ff00ff00ff00ffUL;
+	x = ((x << 8) | (x >> 16)) & 0x0000ffff0000ffffUL;
+	return ((x << 16) | (x >> 32)) & 0xffffffffUL;
+}
+
+static int parse_fail(struct parse_error *err, const char *msg, size_t pos)
+{
+	err->msg = msg;
+	err->pos = pos;
+	return -1;
+}
+
+static int parse_slow(const char *token, const char *p, const char *end,
+		      unsigned int base, u64 *esr, struct parse_error *err)
+{
+	size_t nr_digits = 0;
+	u64 val = 0;
+
+	if (p == end) {
+		return parse_fail(err, "expected a number", p - token);
+	}
+
+	for (; p < end; p++) {
+		unsigned int c = (unsigned char)*p;
+		unsigned int d;
+
+		if (c == '_') {
+			if (!nr_digits || p + 1 == end || p[1] == '_') {
+				return parse_fail(err, "misplaced '_'",
+						  p - token);
+			}
+			continue;
+		}
+
+		if (c - '0' < 10) {
+			d = c - '0';
+		} else if ((c | 0x20) - 'a' < 6) {
+			d = (c | 0x20) - 'a' + 10;
+		} else {
+			d = base;
+		}
+		if (d >= base) {
+			return parse_fail(err,
+					  base == 16 ? "bad hex digit" :
+						       "bad decimal digit",
+					  p - token);
+		}
+		if (val > (~0UL - d) / base) {
+			return parse_fail(err, "value does not fit 64 bits",
+					  p - token);
+		}
+		val = val * base + d;
+		nr_digits++;
+	}
+
+	*esr = val;
+	return 0;
+}
+
+int parse_token(const char *token, size_t len, u64 *esr,
+		struct parse_error *err)
+{
+	const char *p = token, *end = token + len;
+	unsigned int base = parse_decimal ? 10 : 16;
+	size_t n;
+
+	if (len >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+		p += 2;
+		base = 16;
+	}
+
+	n = end - p;
+	if (base == 16 && n && n <= 16) {
+		char digits[16];
+		u64 hi, lo;
+
+		/* Right-aligned, with leading zeros. */
+		memset(digits, '0', sizeof(digits));
+		memcpy(digits + 16 - n, p, n);
+		hi = load8(digits);
+		lo = load8(digits + 8);
+		if (hex8_valid(hi) & hex8_valid(lo)) {
+			*esr = hex8_value(hi) << 32 | hex8_value(lo);
+			return 0;
+		}
+	}
+
+	return parse_slow(token, p, end, base, esr, err);
+}
+
+void parse_error_print(const char *token, size_t len,
+		       const struct parse_error *err)
+{
+	fprintf(stderr, "bad value: %s at column %zu: %.*s\n", err->msg,
+		err->pos + 1, (int)len, token);
+	__atomic_store_n(&parse_failed, 1, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,170 @@
+#include <string.h>
+
+#include "cli.h"
+
+static void field_description(struct outbuf *out, const struct bitfield *field)
+{
+	if (field->width == 1) {
+		out_dec(out, field->start, 2);
+		out_char(out, '\t');
+		out_str(out, field->name);
+		out_str(out, field->value == 1 ? ":\ttrue" : ":\tfalse");
+	} else {
+		out_dec(out, field->start, 2);
+		out_mem(out, "...", 3);
+		out_dec(out, field->start + field->width - 1, 2);
+		out_char(out, '\t');
+		out_str(out, field->name);
+		out_mem(out, ":\t0x", 4);
+		out_hex(out, field->value, 2);
+		out_mem(out, " 0b", 3);
+		out_bin(out, field->value, field->width);
+	}
+
+	if (field->long_name) {
+		out_mem(out, " (", 2);
+		out_str(out, field->long_name);
+		out_char(out, ')');
+	}
+
+	if (field->desc) {
+		out_mem(out, "\t# ", 3);
+		out_str(out, field->desc);
+	}
+	out_char(out, '\n');
+}
+
+void esr_print(struct outbuf *out, const struct esr_result *res)
+{
+	for (size_t i = 0; i < res->nr_fields; i++) {
+		field_description(out, &res->fields[i]);
+	}
+
+	if (!res->sysreg) {
+		return;
+	}
+
+	if (res->sysreg_dir) {
+		out_str(out, "# MRS x");
+		out_dec(out, res->sysreg_rt, 0);
+		out_mem(out, ", ", 2);
+		out_str(out, res->sysreg);
+	} else {
+		out_str(out, "# MSR ");
+		out_str(out, res->sysreg);
+		out_mem(out, ", x", 3);
+		out_dec(out, res->sysreg_rt, 0);
+	}
+	out_char(out, '\n');
+}
+
+/*
+ * Names and descriptions come from libesr's static tables, so every thread
+ * escapes each of them once into a fixed arena and copies it from there by
+ * pointer afterwards.
+ */
+#define JSON_STR_BITS 12
+#define JSON_STR_SLOTS (1 << JSON_STR_BITS)
+#define JSON_STR_ARENA_SIZE (64 << 10)
+
+struct json_str {
+	const char *s;
+	unsigned int offset;
+	unsigned int len;
+};
+
+static __thread struct json_str json_strs[JSON_STR_SLOTS];
+static __thread char json_str_arena[JSON_STR_ARENA_SIZE];
+static __thread size_t json_str_arena_used;
+
+static void json_str_or_null(struct outbuf *out, const char *s)
+{
+	struct json_str *e;
+	size_t start;
+	size_t len;
+
+	if (!s) {
+		out_lit(out, "null");
+		return;
+	}
+
+	e = &json_strs[((unsigned long)s * 0x9e3779b97f4a7c15UL) >>
+		       (64 - JSON_STR_BITS)];
+	if (e->s == s) {
+		out_mem(out, json_str_arena + e->offset, e->len);
+		return;
+	}
+
+	/* Room for the worst case, so that escaping never flushes @out. */
+	len = strlen(s);
+	out_reserve(out, 6 * len + 2);
+	start = out->len;
+	out_json_str(out, s, len);
+
+	len = out->len - start;
+	if (len <= JSON_STR_ARENA_SIZE - json_str_arena_used) {
+		memcpy(json_str_arena + json_str_arena_used, out->buf + start,
+		       len);
+		e->s = s;
+		e->offset = json_str_arena_used;
+		e->len = len;
+		json_str_arena_used += len;
+	}
+}
+
+/*
+ * The members of the JSON object describing @res, from "esr" up to the closing
+ * brace. The caller opens the object.
+ */
+void esr_print_json(struct outbuf *out, const struct esr_result *res)
+{
+	out_lit(out, "\"esr\":\"0x");
+	out_hex(out, res->esr, 16);
+	out_lit(out, "\",\"ec\":");
+	out_dec(out, res->ec, 0);
+	out_lit(out, ",\"ec_desc\":");
+	json_str_or_null(out, res->ec_desc);
+	out_lit(out, ",\"il\":");
+	out_dec(out, res->il, 0);
+	out_lit(out, ",\"iss\":");
+	out_dec(out, res->iss, 0);
+	out_lit(out, ",\"iss2\":");
+	out_dec(out, res->iss2, 0);
+	out_lit(out, ",\"res0_errors\":");
+	out_dec(out, res->nr_res0_errors, 0);
+
+	out_lit(out, ",\"fields\":[");
+	for (size_t i = 0; i < res->nr_fields; i++) {
+		const struct bitfield *field = &res->fields[i];
+
+		if (i) {
+			out_char(out, ',');
+		}
+		out_lit(out, "{\"name\":");
+		json_str_or_null(out, field->name);
+		out_lit(out, ",\"start\":");
+		out_dec(out, field->start, 0);
+		out_lit(out, ",\"end\":");
+		out_dec(out, field->start + field->width - 1, 0);
+		out_lit(out, ",\"value\":");
+		out_dec(out, field->value, 0);
+		out_lit(out, ",\"desc\":");
+		json_str_or_null(out, field->desc);
+		out_char(out, '}');
+	}
+	out_char(out, ']');
+
+	if (res->sysreg) {
+		out_lit(out, ",\"sysreg\":{\"name\":");
+		json_str_or_null(out, res->sysreg);
+		out_lit(out, ",\"rt\":");
+		out_dec(out, res->sysreg_rt, 0);
+		if (res->sysreg_dir) {
+			out_lit(out, ",\"access\":\"MRS\"}");
+		} else {
+			out_lit(out, ",\"access\":\"MSR\"}");
+		}
+	}
+
+	out_char(out, '}');
+}
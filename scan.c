@@ -0,0 +1,310 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "cli.h"
+
+/*
+ * Kernel messages carrying an ESR look like
+ *
+ *   ESR = 0x0000000096000045                   (mem_abort_decode)
+ *   unhandled exception: ..., ESR 0x..., ...   (arm64_show_signal)
+ *   Unknown exception class: esr: 0x... -- ... (KVM handle_exit)
+ *   SError Interrupt on CPU0, code 0x... -- ... (arm64_serror_panic)
+ *   Bad mode in Error handler ..., code 0x...  (bad_mode)
+ *
+ * so candidates are "esr" in any case, and "code 0x" on SError and bad mode
+ * lines. The candidate filter compares the characters at the offsets that
+ * tell both patterns apart 16 bytes at a time, only candidates that pass it
+ * are matched exactly.
+ */
+
+/* Multi-threaded scans hand out the mapping in chunks of this size. */
+#define SCAN_CHUNK_SIZE (1 << 20)
+
+/* Bytes past a candidate the filter looks at ("code 0x"). */
+#define SCAN_LOOKAHEAD 6
+
+static int is_candidate(const char *p, const char *end)
+{
+	if (end - p >= 3 && (p[0] | 0x20) == 'e' && (p[1] | 0x20) == 's' &&
+	    (p[2] | 0x20) == 'r') {
+		return 1;
+	}
+
+	return end - p >= 7 && p[0] == 'c' && p[5] == '0' && p[6] == 'x';
+}
+
+static char *find_candidate(char *p, char *end)
+{
+#if defined(__SSE2__)
+	const __m128i fold = _mm_set1_epi8(0x20);
+	const __m128i e = _mm_set1_epi8('e');
+	const __m128i s = _mm_set1_epi8('s');
+	const __m128i r = _mm_set1_epi8('r');
+	const __m128i c = _mm_set1_epi8('c');
+	const __m128i zero = _mm_set1_epi8('0');
+	const __m128i x = _mm_set1_epi8('x');
+
+	for (; end - p >= 16 + SCAN_LOOKAHEAD; p += 16) {
+		__m128i b0 = _mm_loadu_si128((const __m128i *)p);
+		__m128i b1 = _mm_loadu_si128((const __m128i *)(p + 1));
+		__m128i b2 = _mm_loadu_si128((const __m128i *)(p + 2));
+		__m128i b5 = _mm_loadu_si128((const __m128i *)(p + 5));
+		__m128i b6 = _mm_loadu_si128((const __m128i *)(p + 6));
+		__m128i esr, code;
+		int mask;
+
+		esr = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(b0, fold), e),
+				    _mm_cmpeq_epi8(_mm_or_si128(b1, fold), s));
+		esr = _mm_and_si128(esr,
+				    _mm_cmpeq_epi8(_mm_or_si128(b2, fold), r));
+		code = _mm_and_si128(_mm_cmpeq_epi8(b0, c),
+				     _mm_cmpeq_epi8(b5, zero));
+		code = _mm_and_si128(code, _mm_cmpeq_epi8(b6, x));
+
+		mask = _mm_movemask_epi8(_mm_or_si128(esr, code));
+		if (mask) {
+			return p + __builtin_ctz(mask);
+		}
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const uint8x16_t fold = vdupq_n_u8(0x20);
+
+	for (; end - p >= 16 + SCAN_LOOKAHEAD; p += 16) {
+		const uint8_t *q = (const uint8_t *)p;
+		uint8x16_t esr, code;
+
+		esr = vandq_u8(vceqq_u8(vorrq_u8(vld1q_u8(q), fold),
+					vdupq_n_u8('e')),
+			       vceqq_u8(vorrq_u8(vld1q_u8(q + 1), fold),
+					vdupq_n_u8('s')));
+		esr = vandq_u8(esr, vceqq_u8(vorrq_u8(vld1q_u8(q + 2), fold),
+					     vdupq_n_u8('r')));
+		code = vandq_u8(vceqq_u8(vld1q_u8(q), vdupq_n_u8('c')),
+				vceqq_u8(vld1q_u8(q + 5), vdupq_n_u8('0')));
+		code = vandq_u8(code, vceqq_u8(vld1q_u8(q + 6), vdupq_n_u8('x')));
+
+		/* The scalar loop below finds the candidate in this block. */
+		if (vmaxvq_u8(vorrq_u8(esr, code))) {
+			break;
+		}
+	}
+#endif
+
+	for (; p < end; p++) {
+		if (is_candidate(p, end)) {
+			return p;
+		}
+	}
+
+	return end;
+}
+
+static int hex_val(unsigned char c)
+{
+	if ((unsigned int)(c - '0') < 10) {
+		return c - '0';
+	}
+	c |= 0x20;
+	if ((unsigned int)(c - 'a') < 6) {
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+static int is_word(unsigned char c)
+{
+	return c == '_' || (unsigned int)(c - '0') < 10 ||
+	       (unsigned int)((c | 0x20) - 'a') < 26;
+}
+
+/*
+ * Parse the "0x" prefixed value at @p in place. Returns the end of the value,
+ * or NULL if there is no valid 64-bit hex value at @p.
+ */
+static char *parse_esr(char *p, char *end, u64 *esr)
+{
+	u64 val = 0;
+	int n = 0;
+	int d;
+
+	if (end - p < 3 || p[0] != '0' || (p[1] | 0x20) != 'x') {
+		return NULL;
+	}
+
+	for (p += 2; p < end && (d = hex_val(*p)) >= 0; p++) {
+		if (++n > 16) {
+			return NULL;
+		}
+		val = (val << 4) | d;
+	}
+
+	if (n == 0 || (p < end && is_word(*p))) {
+		return NULL;
+	}
+
+	*esr = val;
+	return p;
+}
+
+/* "ESR = 0x...", "ESR 0x..." or "esr: 0x..." */
+static char *match_esr(char *start, char *p, char *end, char **token,
+		       u64 *esr)
+{
+	if (p > start && is_word(p[-1])) {
+		return NULL;
+	}
+
+	for (p += 3; p < end && *p == ' '; p++)
+		;
+	if (p < end && (*p == '=' || *p == ':')) {
+		p++;
+	}
+	for (; p < end && *p == ' '; p++)
+		;
+
+	*token = p;
+	return parse_esr(p, end, esr);
+}
+
+/* "code 0x..." on SError and bad mode lines */
+static char *match_code(char *start, char *p, char *end, char **token,
+			u64 *esr)
+{
+	char *line;
+
+	if (memcmp(p, "code 0x", 7)) {
+		return NULL;
+	}
+
+	line = memrchr(start, '\n', p - start);
+	line = line ? line + 1 : start;
+	if (!memmem(line, p - line, "SError", 6) &&
+	    !memmem(line, p - line, "Bad mode", 8)) {
+		return NULL;
+	}
+
+	*token = p + 5;
+	return parse_esr(p + 5, end, esr);
+}
+
+/*
+ * Find ESR values in the kernel log text in [start, end) and decode them.
+ * Searching the text counts as parsing for --stats.
+ */
+void scan_range(struct outbuf *out, char *start, char *end)
+{
+	u64 t = stats_enabled ? stats_clock() : 0;
+	char *p = start;
+
+	while ((p = find_candidate(p, end)) < end) {
+		char *token;
+		char *next;
+		u64 esr;
+
+		if ((*p | 0x20) == 'e') {
+			next = match_esr(start, p, end, &token, &esr);
+		} else {
+			next = match_code(start, p, end, &token, &esr);
+		}
+
+		if (next) {
+			if (stats_enabled) {
+				stats_stage(STAGE_PARSE, stats_clock() - t);
+			}
+			decode_esr(out, token, next - token, esr);
+			if (stats_enabled) {
+				t = stats_clock();
+			}
+			p = next;
+		} else {
+			p++;
+		}
+	}
+
+	if (stats_enabled) {
+		stats_stage(STAGE_PARSE, stats_clock() - t);
+	}
+}
+
+/*
+ * Map the file at @path for one sequential read. An empty file gives a NULL
+ * @map, there is nothing to map.
+ */
+int map_file(const char *path, char **map, size_t *size)
+{
+	struct stat st;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (fstat(fd, &st)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	*map = NULL;
+	*size = st.st_size;
+	if (st.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+
+	*map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (*map == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	madvise(*map, st.st_size, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+int scan_file(const char *path, int nr_threads)
+{
+	size_t size;
+	char *map;
+
+	if (map_file(path, &map, &size)) {
+		return -1;
+	}
+	if (!map) {
+		return 0;
+	}
+	if (stats_enabled) {
+		stats_bytes(size, 0);
+	}
+
+	if (nr_threads > 1 && !export_enabled && !group_by_signature) {
+		struct pool *pool = pool_create(nr_threads, scan_range,
+						SCAN_CHUNK_SIZE);
+
+		pool_render(pool, map, map + size);
+		pool_destroy(pool);
+	} else {
+		scan_range(&stdout_buf, map, map + size);
+	}
+
+	munmap(map, size);
+
+	return 0;
+}
@@ -0,0 +1,457 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cli.h"
+#include "esrserve.h"
+
+/*
+ * --serve daemon and --client. The daemon is a single thread around epoll:
+ * every client's complete requests are decoded as soon as they arrive, into
+ * an output buffer that is sent as the socket takes it. A client is not read
+ * from again until its replies are out, which keeps slow readers from
+ * growing their buffers without bound. The decode cache stays warm across
+ * requests and clients for the life of the daemon.
+ */
+#define SERVE_MAX_EVENTS 64
+#define SERVE_READ_SIZE (64 << 10)
+
+/* Values a client sends per request. */
+#define CLIENT_BATCH 1024
+
+struct client {
+	int fd;
+	char *in;
+	size_t in_len;
+	size_t in_size;
+	struct outbuf out;
+	size_t out_sent;
+};
+
+static int unix_socket(const char *path, struct sockaddr_un *addr)
+{
+	int fd;
+
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		fprintf(stderr, "%s: socket path too long\n", path);
+		return -1;
+	}
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+	}
+	return fd;
+}
+
+/*
+ * Remove the socket of a daemon that is gone, which would fail the bind.
+ * Anything else at @path, a live daemon's socket included, is left for the
+ * bind to fail on with EADDRINUSE.
+ */
+static void unlink_stale(const char *path, const struct sockaddr_un *addr)
+{
+	struct stat st;
+	int fd;
+
+	if (lstat(path, &st) || !S_ISSOCK(st.st_mode)) {
+		return;
+	}
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return;
+	}
+	if (connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) &&
+	    errno == ECONNREFUSED) {
+		unlink(path);
+	}
+	close(fd);
+}
+
+static void client_free(int epfd, struct client *c)
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+	close(c->fd);
+	outbuf_free(&c->out);
+	free(c->in);
+	free(c);
+}
+
+/* @esr as "0x..." hex, the way it would be given on the command line. */
+static size_t esr_label(char *buf, u64 esr)
+{
+	static const char digits[] = "0123456789abcdef";
+	int n = (64 - __builtin_clzl(esr | 1) + 3) / 4;
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (int i = n + 1; i > 1; i--, esr >>= 4) {
+		buf[i] = digits[esr & 0xf];
+	}
+	return n + 2;
+}
+
+/* Decode the complete requests in @c's input. Returns -1 on a bad request. */
+static int client_process(struct client *c)
+{
+	size_t done = 0;
+
+	while (c->in_len - done >= sizeof(struct esrserve_request)) {
+		struct esrserve_request req;
+		struct esrserve_reply reply;
+		size_t need, start;
+
+		memcpy(&req, c->in + done, sizeof(req));
+		if (req.count > ESRSERVE_BATCH_MAX || req.flags) {
+			return -1;
+		}
+
+		need = sizeof(req) + req.count * sizeof(u64);
+		if (c->in_len - done < need) {
+			break;
+		}
+
+		out_reserve(&c->out, sizeof(reply));
+		start = c->out.len;
+		c->out.len += sizeof(reply);
+
+		for (size_t i = 0; i < req.count; i++) {
+			char label[20];
+			u64 esr;
+
+			memcpy(&esr, c->in + done + sizeof(req) + i * sizeof(u64),
+			       sizeof(esr));
+			decode_esr(&c->out, label, esr_label(label, esr), esr);
+		}
+
+		/* The buffer may have moved while the text was rendered. */
+		reply.count = req.count;
+		reply.len = c->out.len - start - sizeof(reply);
+		memcpy(c->out.buf + start, &reply, sizeof(reply));
+
+		done += need;
+	}
+
+	c->in_len -= done;
+	memmove(c->in, c->in + done, c->in_len);
+
+	/* Room for the largest request, so that it can complete. */
+	if (c->in_len >= sizeof(struct esrserve_request)) {
+		struct esrserve_request req;
+		size_t need;
+
+		memcpy(&req, c->in, sizeof(req));
+		need = sizeof(req) + req.count * sizeof(u64);
+		if (need > c->in_size) {
+			c->in = realloc(c->in, need);
+			if (!c->in) {
+				perror("malloc");
+				exit(1);
+			}
+			c->in_size = need;
+		}
+	}
+
+	return 0;
+}
+
+/* Send what the socket takes. Returns 1 while output is left, -1 on error. */
+static int client_send(struct client *c)
+{
+	while (c->out_sent < c->out.len) {
+		ssize_t n = send(c->fd, c->out.buf + c->out_sent,
+				 c->out.len - c->out_sent, MSG_NOSIGNAL);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0 && errno == EAGAIN) {
+			return 1;
+		}
+		if (n < 0) {
+			return -1;
+		}
+		c->out_sent += n;
+	}
+
+	c->out.len = c->out_sent = 0;
+	return 0;
+}
+
+/* Handle readiness of @c, returns -1 once the client is gone. */
+static int client_event(int epfd, struct client *c, uint32_t events)
+{
+	struct epoll_event ev = { .data.ptr = c };
+	int pending;
+
+	if (events & EPOLLIN) {
+		ssize_t n = read(c->fd, c->in + c->in_len,
+				 c->in_size - c->in_len);
+
+		if (n < 0 && (errno == EINTR || errno == EAGAIN)) {
+			return 0;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		c->in_len += n;
+		if (client_process(c)) {
+			return -1;
+		}
+	} else if (events & (EPOLLERR | EPOLLHUP)) {
+		return -1;
+	}
+
+	pending = client_send(c);
+	if (pending < 0) {
+		return -1;
+	}
+
+	ev.events = pending ? EPOLLOUT : EPOLLIN;
+	if (epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static void serve_accept(int epfd, int lfd)
+{
+	for (;;) {
+		int fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		struct epoll_event ev = { .events = EPOLLIN };
+		struct client *c;
+
+		if (fd < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				perror("accept");
+			}
+			return;
+		}
+
+		c = calloc(1, sizeof(*c));
+		if (!c) {
+			perror("malloc");
+			exit(1);
+		}
+		c->fd = fd;
+		c->in_size = SERVE_READ_SIZE;
+		c->in = malloc(c->in_size);
+		if (!c->in) {
+			perror("malloc");
+			exit(1);
+		}
+		c->out.fd = -1;
+
+		ev.data.ptr = c;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev)) {
+			perror("epoll_ctl");
+			client_free(epfd, c);
+		}
+	}
+}
+
+int serve(const char *path)
+{
+	struct epoll_event events[SERVE_MAX_EVENTS];
+	struct epoll_event ev = { .events = EPOLLIN };
+	struct sockaddr_un addr;
+	int lfd, epfd;
+
+	lfd = unix_socket(path, &addr);
+	if (lfd < 0) {
+		return -1;
+	}
+
+	unlink_stale(path, &addr);
+	if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(lfd, SOMAXCONN) ||
+	    fcntl(lfd, F_SETFL, O_NONBLOCK)) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(lfd);
+		return -1;
+	}
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev)) {
+		perror("epoll");
+		close(lfd);
+		return -1;
+	}
+
+	for (;;) {
+		int n = epoll_wait(epfd, events, SERVE_MAX_EVENTS, -1);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			perror("epoll_wait");
+			break;
+		}
+
+		for (int i = 0; i < n; i++) {
+			struct client *c = events[i].data.ptr;
+
+			if (!c) {
+				serve_accept(epfd, lfd);
+			} else if (client_event(epfd, c, events[i].events)) {
+				client_free(epfd, c);
+			}
+		}
+	}
+
+	close(epfd);
+	close(lfd);
+	return -1;
+}
+
+static int read_full(int fd, void *buf, size_t len)
+{
+	while (len) {
+		ssize_t n = read(fd, buf, len);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return -1;
+		}
+		buf = (char *)buf + n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t len)
+{
+	while (len) {
+		ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n < 0) {
+			return -1;
+		}
+		buf = (const char *)buf + n;
+		len -= n;
+	}
+	return 0;
+}
+
+/* One request for @count values at @esrs, its reply goes to stdout. */
+static int client_request(int fd, const u64 *esrs, size_t count)
+{
+	struct esrserve_request req = { count, 0 };
+	struct esrserve_reply reply;
+
+	if (write_full(fd, &req, sizeof(req)) ||
+	    write_full(fd, esrs, count * sizeof(u64)) ||
+	    read_full(fd, &reply, sizeof(reply))) {
+		return -1;
+	}
+
+	while (reply.len) {
+		size_t n = reply.len < STREAM_BUF_SIZE ? reply.len :
+							  STREAM_BUF_SIZE;
+
+		if (read_full(fd, out_reserve(&stdout_buf, n), n)) {
+			return -1;
+		}
+		stdout_buf.len += n;
+		reply.len -= n;
+	}
+
+	return 0;
+}
+
+/*
+ * Decode @nr_tokens values at @tokens, or newline-separated values from
+ * stdin if there are none, through the daemon listening at @path.
+ */
+int serve_client(const char *path, char **tokens, int nr_tokens)
+{
+	static u64 esrs[CLIENT_BATCH];
+	struct sockaddr_un addr;
+	struct parse_error err;
+	size_t count = 0;
+	char *line = NULL;
+	const char *token;
+	int bad = 0;
+	ssize_t n;
+	size_t size = 0;
+	int ret = 0;
+	int fd;
+
+	fd = unix_socket(path, &addr);
+	if (fd < 0) {
+		return -1;
+	}
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	for (int i = 0; !ret; i++) {
+		if (nr_tokens) {
+			if (i == nr_tokens) {
+				break;
+			}
+			token = tokens[i];
+			n = strlen(token);
+		} else {
+			n = getline(&line, &size, stdin);
+			if (n < 0) {
+				break;
+			}
+			while (n && (line[n - 1] == '\n' || line[n - 1] == '\r')) {
+				line[--n] = '\0';
+			}
+			if (!n || *line == '#') {
+				continue;
+			}
+			token = line;
+		}
+
+		if (parse_token(token, n, &esrs[count], &err)) {
+			parse_error_print(token, n, &err);
+			bad = 1;
+			continue;
+		}
+		count++;
+
+		if (count == CLIENT_BATCH) {
+			ret = client_request(fd, esrs, count);
+			count = 0;
+		}
+	}
+	if (!ret && count) {
+		ret = client_request(fd, esrs, count);
+	}
+
+	if (ret) {
+		fprintf(stderr, "%s: connection lost\n", path);
+	}
+	if (bad) {
+		ret = -1;
+	}
+
+	free(line);
+	close(fd);
+	return ret;
+}
@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * --group-by-signature: only the first ESR of every esr_signature() is
+ * printed. The signatures seen are kept in an open addressed set of 32-bit
+ * keys, which is all a signature takes. IL is never part of a signature, so
+ * all ones cannot be one and marks a free slot.
+ */
+#define SIGNATURE_MIN_SLOTS 1024
+#define SIGNATURE_FREE 0xffffffffU
+
+int group_by_signature;
+
+static u32 *slots;
+static size_t nr_slots;
+static size_t nr_used;
+static unsigned long nr_seen;
+
+static size_t signature_hash(u32 sig)
+{
+	return (sig * 0x9e3779b97f4a7c15UL) >> (64 - __builtin_ctzl(nr_slots));
+}
+
+static void signature_alloc(size_t n)
+{
+	slots = malloc(n * sizeof(*slots));
+	if (!slots) {
+		perror("malloc");
+		exit(1);
+	}
+	memset(slots, 0xff, n * sizeof(*slots));
+	nr_slots = n;
+}
+
+static void signature_insert(u32 sig)
+{
+	size_t i;
+
+	for (i = signature_hash(sig); slots[i] != SIGNATURE_FREE;
+	     i = (i + 1) & (nr_slots - 1))
+		;
+	slots[i] = sig;
+}
+
+static void signature_grow(void)
+{
+	u32 *old = slots;
+	size_t nr_old = nr_slots;
+
+	signature_alloc(nr_old * 2);
+	for (size_t i = 0; i < nr_old; i++) {
+		if (old[i] != SIGNATURE_FREE) {
+			signature_insert(old[i]);
+		}
+	}
+	free(old);
+}
+
+/* Whether @esr is the first one seen with its signature. */
+int signature_first(u64 esr)
+{
+	u32 sig = esr_signature(esr);
+	size_t i;
+
+	nr_seen++;
+	if (!slots) {
+		signature_alloc(SIGNATURE_MIN_SLOTS);
+	}
+
+	for (i = signature_hash(sig); slots[i] != SIGNATURE_FREE;
+	     i = (i + 1) & (nr_slots - 1)) {
+		if (slots[i] == sig) {
+			return 0;
+		}
+	}
+
+	if (++nr_used > nr_slots / 2) {
+		signature_grow();
+		signature_insert(sig);
+	} else {
+		slots[i] = sig;
+	}
+	return 1;
+}
+
+void signature_stats(unsigned long *seen, size_t *distinct)
+{
+	*seen = nr_seen;
+	*distinct = nr_used;
+}
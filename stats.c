@@ -0,0 +1,259 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+#include "cli.h"
+
+/*
+ * --stats. Every thread adds cycle counts, from the CPU's own counter where
+ * there is one, into its own counters; they are summed up at exit, when the
+ * counter is also calibrated against the wall clock over the whole run.
+ * Nothing here runs unless stats_enabled is set.
+ */
+struct stats {
+	u64 cycles[NR_STAGES];
+	unsigned long bytes_in;
+	unsigned long bytes_out;
+
+	unsigned long values[64];
+	unsigned long decodes[64];
+	u64 decode_cycles[64];
+
+	struct stats *next;
+};
+
+int stats_enabled;
+int stats_json;
+
+static __thread struct stats *thread_stats;
+static pthread_key_t stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+
+static struct stats *stats_list;
+static struct stats retired;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static u64 start_clock;
+static struct timespec start_time;
+
+static const char *const stage_names[NR_STAGES] = {
+	[STAGE_PARSE] = "parse",
+	[STAGE_DECODE] = "decode",
+	[STAGE_RENDER] = "render",
+	[STAGE_WRITE] = "write",
+};
+
+u64 stats_clock(void)
+{
+#if defined(__x86_64__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	u64 val;
+
+	asm volatile("mrs %0, cntvct_el0" : "=r"(val));
+	return val;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+#endif
+}
+
+static void stats_add(struct stats *dst, const struct stats *src)
+{
+	for (int i = 0; i < NR_STAGES; i++) {
+		dst->cycles[i] += src->cycles[i];
+	}
+	dst->bytes_in += src->bytes_in;
+	dst->bytes_out += src->bytes_out;
+	for (int ec = 0; ec < 64; ec++) {
+		dst->values[ec] += src->values[ec];
+		dst->decodes[ec] += src->decodes[ec];
+		dst->decode_cycles[ec] += src->decode_cycles[ec];
+	}
+}
+
+static void stats_release(void *arg)
+{
+	struct stats *s = arg;
+	struct stats **p;
+
+	pthread_mutex_lock(&stats_lock);
+	for (p = &stats_list; *p != s; p = &(*p)->next)
+		;
+	*p = s->next;
+	stats_add(&retired, s);
+	pthread_mutex_unlock(&stats_lock);
+
+	free(s);
+}
+
+static void stats_key_init(void)
+{
+	pthread_key_create(&stats_key, stats_release);
+}
+
+static struct stats *stats_get(void)
+{
+	struct stats *s = thread_stats;
+
+	if (s) {
+		return s;
+	}
+
+	s = calloc(1, sizeof(*s));
+	if (!s) {
+		perror("malloc");
+		exit(1);
+	}
+
+	pthread_mutex_lock(&stats_lock);
+	s->next = stats_list;
+	stats_list = s;
+	pthread_mutex_unlock(&stats_lock);
+
+	pthread_once(&stats_key_once, stats_key_init);
+	pthread_setspecific(stats_key, s);
+
+	thread_stats = s;
+	return s;
+}
+
+void stats_start(void)
+{
+	stats_enabled = 1;
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	start_clock = stats_clock();
+}
+
+void stats_stage(enum stats_stage stage, u64 cycles)
+{
+	stats_get()->cycles[stage] += cycles;
+}
+
+void stats_value(u64 ec)
+{
+	stats_get()->values[ec]++;
+}
+
+void stats_decode(u64 ec, u64 cycles)
+{
+	struct stats *s = stats_get();
+
+	s->decodes[ec]++;
+	s->decode_cycles[ec] += cycles;
+	s->cycles[STAGE_DECODE] += cycles;
+}
+
+void stats_bytes(unsigned long in, unsigned long out)
+{
+	struct stats *s = stats_get();
+
+	s->bytes_in += in;
+	s->bytes_out += out;
+}
+
+static void print_text(FILE *out, const struct stats *all, double secs,
+		       double ns_per_cycle, unsigned long values)
+{
+	unsigned long hits, misses;
+
+	cache_stats(&hits, &misses);
+
+	fprintf(out, "stats: %lu values in %.3f s, %.0f values/s\n", values,
+		secs, secs ? values / secs : 0);
+	fprintf(out, "%-8s %12s %12s\n", "STAGE", "SECONDS", "NS/VALUE");
+	for (int i = 0; i < NR_STAGES; i++) {
+		double ns = all->cycles[i] * ns_per_cycle;
+
+		fprintf(out, "%-8s %12.6f %12.2f\n", stage_names[i], ns * 1e-9,
+			values ? ns / values : 0);
+	}
+	fprintf(out, "bytes: %lu in, %lu out\n", all->bytes_in, all->bytes_out);
+	fprintf(out, "cache: %lu hits, %lu misses, %.2f%% hit rate\n", hits,
+		misses, hits + misses ? 100.0 * hits / (hits + misses) : 0);
+
+	fprintf(out, "%-4s %12s %12s %12s  %s\n", "EC", "VALUES", "DECODES",
+		"NS/DECODE", "DESCRIPTION");
+	for (int ec = 0; ec < 64; ec++) {
+		if (!all->values[ec]) {
+			continue;
+		}
+		fprintf(out, "0x%02x %12lu %12lu %12.2f  %s\n", ec,
+			all->values[ec], all->decodes[ec],
+			all->decodes[ec] ? all->decode_cycles[ec] *
+						   ns_per_cycle /
+						   all->decodes[ec] :
+					   0,
+			esr_ec_desc(ec));
+	}
+}
+
+static void print_json(FILE *out, const struct stats *all, double secs,
+		       double ns_per_cycle, unsigned long values)
+{
+	unsigned long hits, misses;
+	const char *sep = "";
+
+	cache_stats(&hits, &misses);
+
+	fprintf(out, "{\"values\":%lu,\"seconds\":%.6f,\"stages\":{", values,
+		secs);
+	for (int i = 0; i < NR_STAGES; i++) {
+		fprintf(out, "%s\"%s\":%.6f", i ? "," : "", stage_names[i],
+			all->cycles[i] * ns_per_cycle * 1e-9);
+	}
+	fprintf(out, "},\"bytes_in\":%lu,\"bytes_out\":%lu,"
+		     "\"cache_hits\":%lu,\"cache_misses\":%lu,\"ec\":[",
+		all->bytes_in, all->bytes_out, hits, misses);
+	for (int ec = 0; ec < 64; ec++) {
+		if (!all->values[ec]) {
+			continue;
+		}
+		fprintf(out, "%s{\"ec\":%d,\"values\":%lu,\"decodes\":%lu,"
+			     "\"decode_seconds\":%.9f}",
+			sep, ec, all->values[ec], all->decodes[ec],
+			all->decode_cycles[ec] * ns_per_cycle * 1e-9);
+		sep = ",";
+	}
+	fprintf(out, "]}\n");
+}
+
+void stats_print(FILE *out)
+{
+	u64 cycles = stats_clock() - start_clock;
+	struct stats all = { 0 };
+	unsigned long values = 0;
+	struct timespec now;
+	double secs;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	secs = (now.tv_sec - start_time.tv_sec) +
+	       (now.tv_nsec - start_time.tv_nsec) * 1e-9;
+
+	pthread_mutex_lock(&stats_lock);
+	stats_add(&all, &retired);
+	for (struct stats *s = stats_list; s; s = s->next) {
+		stats_add(&all, s);
+	}
+	pthread_mutex_unlock(&stats_lock);
+
+	for (int ec = 0; ec < 64; ec++) {
+		values += all.values[ec];
+	}
+
+	if (stats_json) {
+		print_json(out, &all, secs,
+			   cycles ? secs * 1e9 / cycles : 0, values);
+	} else {
+		print_text(out, &all, secs,
+			   cycles ? secs * 1e9 / cycles : 0, values);
+	}
+}
@@ -0,0 +1,236 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cli.h"
+
+/* Exception classes to decode, one bit per EC. */
+u64 ec_mask = ~0UL;
+
+enum output_format output_format = FORMAT_TEXT;
+
+static void render(struct outbuf *out, const struct esr_result *res)
+{
+	u64 t = stats_enabled ? stats_clock() : 0;
+
+	if (output_format == FORMAT_JSON) {
+		esr_print_json(out, res);
+	} else {
+		esr_print(out, res);
+	}
+
+	if (stats_enabled) {
+		stats_stage(STAGE_RENDER, stats_clock() - t);
+	}
+}
+
+static void decode(u64 esr, struct esr_result *res)
+{
+	u64 t = stats_enabled ? stats_clock() : 0;
+
+	esr_decode(esr, res);
+
+	if (stats_enabled) {
+		stats_decode(ESR_EC(esr), stats_clock() - t);
+	}
+}
+
+/*
+ * Decode and print @esr, labelled with the @len bytes of input at @token, or
+ * just count it under --summary or store it under --export. Values outside
+ * --ec or --filter, and repeated signatures under --group-by-signature, are
+ * dropped first. In JSON mode every ESR is one line holding an object, whose
+ * "input" member is the label, and --oneline prints just a line per ESR.
+ */
+void decode_esr(struct outbuf *out, const char *token, size_t len, u64 esr)
+{
+	struct esr_result res;
+	const char *text;
+	size_t start;
+	size_t n;
+
+	if (!(ec_mask & (1UL << ESR_EC(esr))) ||
+	    (filter_enabled && !filter_match(esr)) ||
+	    (group_by_signature && !signature_first(esr))) {
+		return;
+	}
+
+	if (stats_enabled) {
+		stats_value(ESR_EC(esr));
+	}
+
+	if (summary_enabled) {
+		summary_add(esr);
+		return;
+	}
+
+	if (export_enabled) {
+		export_add(esr);
+		return;
+	}
+
+	if (output_format == FORMAT_ONELINE) {
+		u64 t = stats_enabled ? stats_clock() : 0;
+
+		oneline_render(out, token, len, esr);
+		if (stats_enabled) {
+			stats_stage(STAGE_RENDER, stats_clock() - t);
+		}
+		return;
+	}
+
+	if (output_format == FORMAT_JSON) {
+		out_mem(out, "{\"input\":", 9);
+		out_json_str(out, token, len);
+		out_char(out, ',');
+	} else {
+		out_mem(out, "ESR: ", 5);
+		out_mem(out, token, len);
+		out_char(out, '\n');
+	}
+
+	if (!cache_enabled) {
+		decode(esr, &res);
+		render(out, &res);
+	} else if ((text = cache_lookup(esr, &n)) != NULL) {
+		out_mem(out, text, n);
+	} else {
+		/*
+		 * With ESR_TEXT_MAX bytes of room the buffer cannot be flushed
+		 * while printing, so the rendered text can be cached from it.
+		 */
+		decode(esr, &res);
+		out_reserve(out, ESR_TEXT_MAX);
+		start = out->len;
+		render(out, &res);
+		cache_insert(esr, out->buf + start, out->len - start);
+	}
+
+	out_char(out, '\n');
+}
+
+static void decode_text(struct outbuf *out, const char *token, size_t len)
+{
+	u64 t = stats_enabled ? stats_clock() : 0;
+	struct parse_error err;
+	u64 esr;
+	int bad = parse_token(token, len, &esr, &err);
+
+	if (stats_enabled) {
+		stats_stage(STAGE_PARSE, stats_clock() - t);
+	}
+	if (bad) {
+		parse_error_print(token, len, &err);
+		return;
+	}
+	decode_esr(out, token, len, esr);
+}
+
+void decode_token(struct outbuf *out, const char *token)
+{
+	decode_text(out, token, strlen(token));
+}
+
+void decode_line(struct outbuf *out, char *line, char *end)
+{
+	while (line < end && (*line == ' ' || *line == '\t')) {
+		line++;
+	}
+	while (end > line && (end[-1] == ' ' || end[-1] == '\t' ||
+			      end[-1] == '\r')) {
+		end--;
+	}
+	if (line == end || *line == '#') {
+		return;
+	}
+	decode_text(out, line, end - line);
+}
+
+/*
+ * Decode newline-separated ESR values from @fd. Input is consumed through a
+ * fixed-size buffer, so memory use does not depend on the input size. Lines
+ * that do not fit into the buffer are dropped.
+ */
+int decode_stream(int fd, const char *name)
+{
+	static char buf[STREAM_BUF_SIZE];
+	size_t len = 0;
+	int skip = 0;
+	ssize_t n;
+
+	for (;;) {
+		n = read(fd, buf + len, sizeof(buf) - 1 - len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			break;
+		}
+		if (stats_enabled) {
+			stats_bytes(n, 0);
+		}
+
+		char *p = buf;
+		char *end = buf + len + n;
+		char *nl;
+
+		while ((nl = memchr(p, '\n', end - p)) != NULL) {
+			if (!skip) {
+				decode_line(&stdout_buf, p, nl);
+			}
+			skip = 0;
+			p = nl + 1;
+		}
+
+		len = end - p;
+		if (len == STREAM_LINE_MAX) {
+			fprintf(stderr, "%s: line too long, skipped\n", name);
+			skip = 1;
+			len = 0;
+		}
+		memmove(buf, p, len);
+	}
+
+	if (n < 0) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return -1;
+	}
+
+	if (len && !skip) {
+		decode_line(&stdout_buf, buf, buf + len);
+	}
+
+	return 0;
+}
+
+int decode_fd(int fd, const char *name, int nr_threads)
+{
+	/*
+	 * --export appends rows to a single file in input order, and
+	 * --group-by-signature keeps the first ESR of each signature.
+	 */
+	if (nr_threads > 1 && !export_enabled && !group_by_signature) {
+		return decode_stream_parallel(fd, name, nr_threads);
+	}
+
+	return decode_stream(fd, name);
+}
+
+int decode_file(const char *path, int nr_threads)
+{
+	int fd = open(path, O_RDONLY);
+	int ret;
+
+	if (fd < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	ret = decode_fd(fd, path, nr_threads);
+	close(fd);
+
+	return ret;
+}
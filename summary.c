@@ -0,0 +1,269 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cli.h"
+
+/*
+ * Counters for --summary, keyed by esr_signature(), and for --kvm-profile,
+ * each in a table of its own. Every thread counts into its own open addressed
+ * tables, so the hot path is a mask, a hash and an increment. Tables of
+ * exited threads are folded into retired tables, the rest are merged when
+ * the counts are printed.
+ */
+#define SUMMARY_MIN_SLOTS 1024
+
+struct summary {
+	struct summary_entry *slots;
+	size_t nr_slots;
+	size_t nr_used;
+};
+
+struct summary_thread {
+	struct summary tables[NR_SUMMARY_TABLES];
+	struct summary_thread *next;
+};
+
+int summary_enabled;
+size_t summary_top = 20;
+
+static __thread struct summary_thread *thread_summary;
+static pthread_key_t summary_key;
+static pthread_once_t summary_key_once = PTHREAD_ONCE_INIT;
+
+static struct summary_thread *summaries;
+static struct summary retired[NR_SUMMARY_TABLES];
+static pthread_mutex_t summaries_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t summary_hash(u64 key, size_t nr_slots)
+{
+	/* Fibonacci hashing, nr_slots is a power of two. */
+	return (key * 0x9e3779b97f4a7c15UL) >> (64 - __builtin_ctzl(nr_slots));
+}
+
+static void summary_alloc(struct summary *s, size_t nr_slots)
+{
+	s->slots = calloc(nr_slots, sizeof(*s->slots));
+	if (!s->slots) {
+		perror("malloc");
+		exit(1);
+	}
+	s->nr_slots = nr_slots;
+	s->nr_used = 0;
+}
+
+static struct summary_entry *summary_slot(struct summary *s, u64 key);
+
+static void summary_grow(struct summary *s)
+{
+	struct summary_entry *old = s->slots;
+	size_t nr_old = s->nr_slots;
+
+	summary_alloc(s, nr_old * 2);
+	for (size_t i = 0; i < nr_old; i++) {
+		if (old[i].count) {
+			summary_slot(s, old[i].key)->count = old[i].count;
+		}
+	}
+	free(old);
+}
+
+/* Find the slot of @key, claiming a free one if it is not counted yet. */
+static struct summary_entry *summary_slot(struct summary *s, u64 key)
+{
+	size_t i;
+
+	if (!s->slots) {
+		summary_alloc(s, SUMMARY_MIN_SLOTS);
+	}
+
+	for (i = summary_hash(key, s->nr_slots); s->slots[i].count;
+	     i = (i + 1) & (s->nr_slots - 1)) {
+		if (s->slots[i].key == key) {
+			return &s->slots[i];
+		}
+	}
+
+	if (s->nr_used >= s->nr_slots / 2) {
+		summary_grow(s);
+		return summary_slot(s, key);
+	}
+
+	s->nr_used++;
+	s->slots[i].key = key;
+	return &s->slots[i];
+}
+
+static void summary_merge(struct summary *dst, const struct summary *src)
+{
+	/*
+	 * Walking @src in slot order inserts keys in hash order, which piles
+	 * them up into one long probe run in a smaller table.
+	 */
+	if (!dst->slots && src->nr_slots) {
+		summary_alloc(dst, src->nr_slots);
+	}
+	while (dst->nr_slots < src->nr_slots) {
+		summary_grow(dst);
+	}
+
+	for (size_t i = 0; i < src->nr_slots; i++) {
+		if (src->slots[i].count) {
+			summary_slot(dst, src->slots[i].key)->count +=
+				src->slots[i].count;
+		}
+	}
+}
+
+static void summary_release(void *arg)
+{
+	struct summary_thread *s = arg;
+	struct summary_thread **p;
+
+	pthread_mutex_lock(&summaries_lock);
+	for (p = &summaries; *p != s; p = &(*p)->next)
+		;
+	*p = s->next;
+	for (int i = 0; i < NR_SUMMARY_TABLES; i++) {
+		summary_merge(&retired[i], &s->tables[i]);
+	}
+	pthread_mutex_unlock(&summaries_lock);
+
+	for (int i = 0; i < NR_SUMMARY_TABLES; i++) {
+		free(s->tables[i].slots);
+	}
+	free(s);
+}
+
+static void summary_key_init(void)
+{
+	pthread_key_create(&summary_key, summary_release);
+}
+
+static struct summary_thread *summary_get(void)
+{
+	struct summary_thread *s = thread_summary;
+
+	if (s) {
+		return s;
+	}
+
+	s = calloc(1, sizeof(*s));
+	if (!s) {
+		perror("malloc");
+		exit(1);
+	}
+
+	pthread_mutex_lock(&summaries_lock);
+	s->next = summaries;
+	summaries = s;
+	pthread_mutex_unlock(&summaries_lock);
+
+	pthread_once(&summary_key_once, summary_key_init);
+	pthread_setspecific(summary_key, s);
+
+	thread_summary = s;
+	return s;
+}
+
+void summary_count(enum summary_table table, u64 key)
+{
+	summary_slot(&summary_get()->tables[table], key)->count++;
+}
+
+void summary_add(u64 esr)
+{
+	summary_count(SUMMARY_ESR, esr_signature(esr));
+}
+
+static int summary_cmp(const void *a, const void *b)
+{
+	const struct summary_entry *x = a, *y = b;
+
+	if (x->count != y->count) {
+		return x->count < y->count ? 1 : -1;
+	}
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+/* The ISS fields of @res that lie entirely within the summary mask. */
+static void summary_describe(FILE *out, const struct esr_result *res)
+{
+	u64 key_mask = esr_summary_mask(res->esr);
+	const char *sep = ": ";
+
+	fprintf(out, "%s", res->ec_desc);
+
+	for (size_t i = 0; i < res->nr_fields; i++) {
+		const struct bitfield *f = &res->fields[i];
+		u64 mask = ((1UL << f->width) - 1) << f->start;
+
+		if (f->start + f->width > 25 || (key_mask & mask) != mask ||
+		    !strcmp(f->name, "RES0")) {
+			continue;
+		}
+		fprintf(out, "%s%s=0x%lx", sep, f->name, f->value);
+		if (f->desc) {
+			fprintf(out, " (%s)", f->desc);
+		}
+		sep = ", ";
+	}
+
+	if (res->sysreg) {
+		fprintf(out, "%s%s %s", sep, res->sysreg_dir ? "MRS" : "MSR",
+			res->sysreg);
+	}
+}
+
+/*
+ * The counts of all threads in @table, most frequent first, in an array the
+ * caller frees. Returns the number of entries.
+ */
+size_t summary_sorted(enum summary_table table,
+		      struct summary_entry **entries, unsigned long *total)
+{
+	struct summary all = { 0 };
+	size_t n = 0;
+
+	pthread_mutex_lock(&summaries_lock);
+	summary_merge(&all, &retired[table]);
+	for (struct summary_thread *s = summaries; s; s = s->next) {
+		summary_merge(&all, &s->tables[table]);
+	}
+	pthread_mutex_unlock(&summaries_lock);
+
+	*total = 0;
+	for (size_t i = 0; i < all.nr_slots; i++) {
+		if (all.slots[i].count) {
+			*total += all.slots[i].count;
+			all.slots[n++] = all.slots[i];
+		}
+	}
+	qsort(all.slots, n, sizeof(*all.slots), summary_cmp);
+
+	*entries = all.slots;
+	return n;
+}
+
+void summary_print(FILE *out)
+{
+	struct summary_entry *entries;
+	unsigned long total;
+	size_t n = summary_sorted(SUMMARY_ESR, &entries, &total);
+
+	fprintf(out, "%12s %7s  %-18s  %s\n", "COUNT", "SHARE", "KEY",
+		"DESCRIPTION");
+	for (size_t i = 0; i < n && i < summary_top; i++) {
+		struct esr_result res;
+
+		esr_decode(entries[i].key, &res);
+		fprintf(out, "%12lu %6.2f%%  0x%016lx  ", entries[i].count,
+			100.0 * entries[i].count / total, entries[i].key);
+		summary_describe(out, &res);
+		fprintf(out, "\n");
+	}
+	fprintf(out, "%12lu total, %zu distinct\n", total, n);
+
+	free(entries);
+}